@@ -0,0 +1,213 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "activation.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* First descriptor passed by the service manager (SD_LISTEN_FDS_START) */
+#define LISTEN_FDS_START 3
+
+/* Datagrams read at once, so that a flood does not starve the bar */
+#define DATAGRAMS_MAX 64
+
+static long long microseconds(clockid_t clock)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Time the process started on CLOCK_MONOTONIC, from its start in clock
+ * ticks since boot (so only to the tick), otherwise the current time */
+static long long process_start(void)
+{
+    long long now = microseconds(CLOCK_MONOTONIC);
+#ifdef __linux__
+    char status[1024];
+    unsigned long long ticks;
+    FILE *file = fopen("/proc/self/stat", "r");
+    size_t length;
+    char *fields;
+
+    if (file == NULL)
+        return now;
+    length = fread(status, 1, sizeof(status) - 1, file);
+    fclose(file);
+    status[length] = '\0';
+
+    /* The start is the 22nd field, the 2nd one being the name of the
+     * command in parentheses, which may hold spaces */
+    fields = strrchr(status, ')');
+    if (fields != NULL &&
+        sscanf(fields + 1,
+               "%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s "
+               "%*s %*s %*s %*s %llu",
+               &ticks) == 1)
+        return now - (microseconds(CLOCK_BOOTTIME) -
+                      (long long)ticks * 1000000 / sysconf(_SC_CLK_TCK));
+#endif
+    return now;
+}
+
+bool activation_open(Activation *activation, FILE *trace)
+{
+    const char *pid = getenv("LISTEN_PID");
+    const char *fds = getenv("LISTEN_FDS");
+    int count = fds != NULL ? atoi(fds) : 0;
+    int type;
+    socklen_t length = sizeof(type);
+
+    /* The variables are meant for this process, not for its children */
+    if (pid == NULL || atol(pid) != (long)getpid() || count < 1)
+        return false;
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+
+    if (getsockopt(LISTEN_FDS_START, SOL_SOCKET, SO_TYPE, &type, &length) !=
+        0)
+    {
+        fprintf(stderr, "Error: the descriptor passed is not a socket.\n");
+        return false;
+    }
+    if (count > 1)
+        fprintf(stderr,
+                "Warning: %d sockets passed, only the first one is read.\n",
+                count);
+
+    activation->socket = LISTEN_FDS_START;
+    activation->stream = type != SOCK_DGRAM;
+    activation->clients_count = 0;
+    activation->datagram = (Input_buffer){.length = 0, .trace = trace};
+    activation->activated = process_start();
+    fcntl(activation->socket, F_SETFD, FD_CLOEXEC);
+    fcntl(activation->socket, F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+int activation_set_fds(Activation *activation, fd_set *read_fds)
+{
+    int max_fd = -1;
+
+    /* Further connections wait in the backlog of the socket */
+    if (!activation->stream ||
+        activation->clients_count < ACTIVATION_CLIENTS_MAX)
+    {
+        FD_SET(activation->socket, read_fds);
+        max_fd = activation->socket;
+    }
+    for (int i = 0; i < activation->clients_count; i++)
+    {
+        FD_SET(activation->clients[i].fd, read_fds);
+        if (activation->clients[i].fd > max_fd)
+            max_fd = activation->clients[i].fd;
+    }
+    return max_fd;
+}
+
+static void read_datagrams(Activation *activation, const Style_index *styles,
+                           Input_value *newest, int *count)
+{
+    Input_buffer *buffer = &activation->datagram;
+    ssize_t length;
+    int parsed;
+
+    for (int i = 0; i < DATAGRAMS_MAX; i++)
+    {
+        length = recv(activation->socket, buffer->data, INPUT_BUFFER_SIZE,
+                      MSG_DONTWAIT);
+        if (length < 0)
+            break;
+
+        /* A datagram filling the buffer may have been truncated */
+        if (length == INPUT_BUFFER_SIZE)
+        {
+            fprintf(stderr, "Warning: datagram too long, dropped.\n");
+            continue;
+        }
+        buffer->length = length;
+        if (!parse_input(buffer, true, styles, newest, &parsed))
+            fprintf(stderr, "Warning: unexpected input in a datagram.\n");
+        *count += parsed;
+    }
+}
+
+static void close_client(Activation *activation, int i)
+{
+    close(activation->clients[i].fd);
+    activation->clients[i] = activation->clients[--activation->clients_count];
+}
+
+static void accept_client(Activation *activation)
+{
+    int fd = accept4(activation->socket, NULL, NULL,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0)
+        return;
+    activation->clients[activation->clients_count++] = (Activation_client){
+        .fd = fd,
+        .buffer = {.length = 0, .trace = activation->datagram.trace}};
+}
+
+void activation_read(Activation *activation, fd_set *read_fds,
+                     const Style_index *styles, Input_value *newest,
+                     int *count)
+{
+    Activation_client *client;
+    int parsed;
+
+    *count = 0;
+
+    if (!activation->stream)
+    {
+        if (FD_ISSET(activation->socket, read_fds))
+            read_datagrams(activation, styles, newest, count);
+        return;
+    }
+
+    /* Backwards, as a closed connection is replaced by the last one */
+    for (int i = activation->clients_count - 1; i >= 0; i--)
+    {
+        client = &activation->clients[i];
+        if (!FD_ISSET(client->fd, read_fds))
+            continue;
+        if (!read_input(client->fd, &client->buffer, styles, newest, &parsed))
+            close_client(activation, i);
+        *count += parsed;
+    }
+
+    if (FD_ISSET(activation->socket, read_fds) &&
+        activation->clients_count < ACTIVATION_CLIENTS_MAX)
+        accept_client(activation);
+}
+
+void activation_close(Activation *activation)
+{
+    while (activation->clients_count > 0)
+        close_client(activation, activation->clients_count - 1);
+    close(activation->socket);
+}
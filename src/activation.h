@@ -0,0 +1,71 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include "input.h"
+#include <stdbool.h>
+#include <sys/select.h>
+
+/* Connections read at the same time from a stream socket */
+#define ACTIVATION_CLIENTS_MAX 8
+
+typedef struct
+{
+    int fd;
+    Input_buffer buffer;
+} Activation_client;
+
+/* A socket inherited from a service manager starting xob on the first
+ * connection or datagram, as systemd does with LISTEN_FDS (socket
+ * activation). A datagram socket is read directly, each datagram holding
+ * whole values. Connections to a stream socket are accepted and each one is
+ * read like the standard input. */
+typedef struct
+{
+    int socket;
+    bool stream;
+    Activation_client clients[ACTIVATION_CLIENTS_MAX];
+    int clients_count;
+    Input_buffer datagram;
+    /* Time xob was started on CLOCK_MONOTONIC in microseconds, to within a
+     * clock tick: the time of the first connection or datagram, which is
+     * not stamped by the kernel as long as no one is listening */
+    long long activated;
+} Activation;
+
+/* Take the socket passed to xob, the first one if several are passed, and
+ * record the values read in a trace if not NULL. Returns false if no socket
+ * was passed. */
+bool activation_open(Activation *activation, FILE *trace);
+
+/* Add the descriptors to wait for to the set of select(), returns the
+ * highest one */
+int activation_set_fds(Activation *activation, fd_set *read_fds);
+
+/* Accept connections and read the values available according to the set
+ * returned by select(). The newest value replaces *newest and the number of
+ * values read is stored in *count. Connections are closed at their end or
+ * after unexpected input, datagrams are only read up to it. */
+void activation_read(Activation *activation, fd_set *read_fds,
+                     const Style_index *styles, Input_value *newest,
+                     int *count);
+
+void activation_close(Activation *activation);
+
+#endif
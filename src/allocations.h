@@ -0,0 +1,34 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <stdbool.h>
+
+/* Heap allocations made by the program and the libraries it calls, counted
+ * in builds with check_allocations=yes to make sure that nothing is
+ * allocated once the bar is up and running */
+
+/* Start counting, from any thread */
+void allocations_watch(void);
+
+/* Store the number of allocations counted since allocations_watch() in
+ * *count. Returns false if allocations are not counted in this build. */
+bool allocations_counted(unsigned long *count);
+
+#endif
@@ -0,0 +1,88 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The allocation functions of the C library are replaced by wrappers that
+ * count the calls, for every library the program is linked with. Only for
+ * the GNU C library, which exports the functions wrapped under other
+ * names. */
+
+#define _GNU_SOURCE
+
+#include "allocations.h"
+#include <errno.h>
+#include <stddef.h>
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+static int watching = 0;
+static unsigned long counted = 0;
+
+static void tally(void)
+{
+    if (__atomic_load_n(&watching, __ATOMIC_RELAXED))
+        __atomic_add_fetch(&counted, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    tally();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    tally();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    tally();
+    return __libc_realloc(pointer, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    tally();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    void *memory;
+
+    tally();
+    memory = __libc_memalign(alignment, size);
+    if (memory == NULL)
+        return ENOMEM;
+    *pointer = memory;
+    return 0;
+}
+
+void allocations_watch(void)
+{
+    __atomic_store_n(&watching, 1, __ATOMIC_RELAXED);
+}
+
+bool allocations_counted(unsigned long *count)
+{
+    *count = __atomic_load_n(&counted, __ATOMIC_RELAXED);
+    return true;
+}
@@ -0,0 +1,529 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* xob-bench: measure how fast the input parser goes through generated
+ * streams of values, read whole or in small partial writes, and fuzz it.
+ * Random inputs must be parsed alike whatever the writes they are split
+ * into, without reading past them, and generated values must be parsed back
+ * as they were. No X server is needed. */
+
+#define _XOPEN_SOURCE 600
+
+#include "input.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Size of a generated stream */
+#define STREAM_SIZE (16 << 20)
+
+/* Sizes of the partial writes, drawn beforehand */
+#define WRITE_SIZES 4096
+#define PARTIAL_WRITE_MAX 16
+
+/* Longest input fuzzed, which always fits in the buffer of the parser */
+#define FUZZ_SIZE 512
+
+/* Values of an input generated to be parsed back */
+#define FUZZ_VALUES_MAX 16
+
+/* Seconds an input may take to be parsed before the fuzzer gives up */
+#define FUZZ_TIMEOUT 5
+
+static const char *style_names[] = {"default", "mute", "a", "ab"};
+#define STYLES_COUNT (int)(sizeof(style_names) / sizeof(style_names[0]))
+
+static Style_index styles;
+
+/* xorshift64*, reproducible from a seed */
+static uint64_t random_state = 1;
+
+static uint32_t random_next(void)
+{
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (random_state * 2685821657736338717ULL) >> 32;
+}
+
+static uint32_t random_below(uint32_t n)
+{
+    return random_next() % n;
+}
+
+static long long monotonic_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Benchmark */
+
+typedef struct
+{
+    const char *name;
+    /* Format a value, returns the number of characters written */
+    int (*format)(char *text, int value);
+} Workload;
+
+static int format_plain(char *text, int value)
+{
+    return sprintf(text, "%d\n", value);
+}
+
+static int format_alternative(char *text, int value)
+{
+    return sprintf(text, "%d!\n", value);
+}
+
+static int format_spaced(char *text, int value)
+{
+    return sprintf(text, "  %d \t\r\n", value);
+}
+
+static int format_styled(char *text, int value)
+{
+    return sprintf(text, "%d@mute\n", value);
+}
+
+static int format_stamped(char *text, int value)
+{
+    return sprintf(text, "%d#%lld\n", value, 1000000000000LL + value);
+}
+
+static const Workload workloads[] = {
+    {"plain", format_plain},   {"alternative", format_alternative},
+    {"spaced", format_spaced}, {"styled", format_styled},
+    {"stamped", format_stamped},
+};
+
+static unsigned short write_sizes[WRITE_SIZES];
+
+/* Fill a stream with values from 0 to 100, returns its size */
+static size_t generate_stream(char *stream, const Workload *workload,
+                              long *values)
+{
+    size_t size = 0;
+
+    *values = 0;
+    while (size < STREAM_SIZE)
+    {
+        size += workload->format(stream + size, (*values)++ % 101);
+    }
+    return size;
+}
+
+/* Feed a stream to the parser as read_input() would, in writes of the size
+ * of the buffer or in partial writes. Returns the values parsed per
+ * second. */
+static double measure(const char *stream, size_t size, long expected,
+                      bool partial)
+{
+    Input_buffer buffer = {.length = 0, .trace = NULL};
+    Input_value newest;
+    size_t position = 0;
+    size_t length;
+    long values = 0;
+    int count;
+    int writes = 0;
+    long long start = monotonic_now();
+
+    while (position < size)
+    {
+        length = partial ? write_sizes[writes++ % WRITE_SIZES]
+                         : INPUT_BUFFER_SIZE;
+        if (length > INPUT_BUFFER_SIZE - buffer.length)
+            length = INPUT_BUFFER_SIZE - buffer.length;
+        if (length > size - position)
+            length = size - position;
+        memcpy(buffer.data + buffer.length, stream + position, length);
+        buffer.length += length;
+        position += length;
+        if (!parse_input(&buffer, false, &styles, &newest, &count))
+        {
+            fprintf(stderr, "Error: unexpected input at byte %zu.\n",
+                    position);
+            exit(EXIT_FAILURE);
+        }
+        values += count;
+    }
+    parse_input(&buffer, true, &styles, &newest, &count);
+    values += count;
+
+    if (values != expected)
+    {
+        fprintf(stderr, "Error: %ld values parsed out of %ld.\n", values,
+                expected);
+        exit(EXIT_FAILURE);
+    }
+    return values * 1e9 / (monotonic_now() - start);
+}
+
+static void benchmark(void)
+{
+    char *stream = malloc(STREAM_SIZE + 64);
+    size_t size;
+    long values;
+    double whole;
+    double partial;
+
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Error: could not allocate the streams.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < WRITE_SIZES; i++)
+        write_sizes[i] = 1 + random_below(PARTIAL_WRITE_MAX);
+
+    printf("%-12s %10s %12s %10s %12s\n", "workload", "bytes/value",
+           "whole Mv/s", "MB/s", "1-16 B Mv/s");
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+    {
+        size = generate_stream(stream, &workloads[i], &values);
+        whole = measure(stream, size, values, false);
+        partial = measure(stream, size, values, true);
+        printf("%-12s %10.1f %12.1f %10.1f %12.1f\n", workloads[i].name,
+               (double)size / values, whole / 1e6,
+               whole * size / values / 1e6, partial / 1e6);
+    }
+    free(stream);
+}
+
+/* Fuzzer */
+
+typedef struct
+{
+    bool expected;
+    int count;
+    Input_value newest;
+} Parse_result;
+
+/* Bytes of the buffer past the input are set to a filler, which changes the
+ * result if they are read */
+static void fill(Input_buffer *buffer, char filler)
+{
+    memset(buffer->data + buffer->length, filler,
+           INPUT_BUFFER_SIZE - buffer->length);
+}
+
+/* Parse an input given at once */
+static Parse_result parse_whole(const char *input, size_t size, char filler)
+{
+    Input_buffer buffer = {.length = size, .trace = NULL};
+    Parse_result result = {.newest = {.valid = false}};
+
+    memcpy(buffer.data, input, size);
+    fill(&buffer, filler);
+    result.expected =
+        parse_input(&buffer, true, &styles, &result.newest, &result.count);
+    return result;
+}
+
+/* Parse an input written in random parts, until unexpected input as
+ * read_input() */
+static Parse_result parse_split(const char *input, size_t size, char filler)
+{
+    Input_buffer buffer = {.length = 0, .trace = NULL};
+    Parse_result result = {.expected = true, .count = 0};
+    size_t position = 0;
+    size_t length;
+    int count;
+
+    result.newest.valid = false;
+    while (result.expected)
+    {
+        length = position < size ? random_below(size - position + 1) : 0;
+        memcpy(buffer.data + buffer.length, input + position, length);
+        buffer.length += length;
+        position += length;
+        fill(&buffer, filler);
+        result.expected = parse_input(&buffer, position == size, &styles,
+                                      &result.newest, &count);
+        result.count += count;
+        if (position == size)
+            break;
+    }
+    return result;
+}
+
+static bool same_value(Input_value a, Input_value b)
+{
+    return a.valid == b.valid && a.value == b.value &&
+           a.show_mode == b.show_mode && a.style == b.style &&
+           a.emitted == b.emitted;
+}
+
+static bool same_result(Parse_result a, Parse_result b)
+{
+    return a.expected == b.expected && a.count == b.count &&
+           (a.count == 0 || same_value(a.newest, b.newest));
+}
+
+static void report(const char *problem, const char *input, size_t size)
+{
+    fprintf(stderr, "Error: %s, input \"", problem);
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned char c = input[i];
+        if (c >= ' ' && c < 127 && c != '"' && c != '\\')
+            fputc(c, stderr);
+        else
+            fprintf(stderr, "\\x%02x", c);
+    }
+    fprintf(stderr, "\".\n");
+    abort();
+}
+
+/* Any input is parsed alike in one part or several */
+static void check_input(const char *input, size_t size)
+{
+    Parse_result whole = parse_whole(input, size, '1');
+    Parse_result split = parse_split(input, size, '8');
+
+    if (!same_result(whole, split))
+        report("parsed differently whole and split", input, size);
+    if (!same_result(whole, parse_whole(input, size, '0')))
+        report("parsed past its end", input, size);
+}
+
+/* Format a random value at the end of a text, returns its new length */
+static size_t generate_value(char *text, size_t length, Input_value *value)
+{
+    static const char terminators[] = "!\n \t";
+    long long number = random_below(4) == 0
+                           ? (long long)random_next() * random_below(1000)
+                           : random_below(101);
+    int sign = random_below(8);
+    char terminator = terminators[random_below(sizeof(terminators) - 1)];
+
+    value->valid = true;
+    value->value = number > INT_MAX ? INT_MAX : number;
+    value->value = sign == 0 ? -value->value : value->value;
+    length += sprintf(text + length, "%s%lld",
+                      sign == 0   ? "-"
+                      : sign == 1 ? "+"
+                                  : "",
+                      number);
+
+    value->style = 0;
+    if (random_below(3) == 0)
+    {
+        value->style = random_below(STYLES_COUNT);
+        length += sprintf(text + length, "@%s", style_names[value->style]);
+    }
+
+    value->emitted = -1;
+    if (random_below(3) == 0)
+    {
+        value->emitted = (long long)random_next() << 8 | random_below(256);
+        length += sprintf(text + length, "#%lld", value->emitted);
+    }
+
+    value->show_mode = terminator == '!' ? ALTERNATIVE : NORMAL;
+    text[length++] = terminator;
+    while (random_below(4) == 0)
+        text[length++] = ' ';
+    return length;
+}
+
+/* Change a few characters, mostly to ones the parser looks for */
+static size_t mutate(char *text, size_t length)
+{
+    static const char alphabet[] = "0123456789+-!@#ab \n\t";
+    int mutations = random_below(4);
+
+    for (int i = 0; i < mutations; i++)
+    {
+        size_t position = random_below(length + 1);
+        char c = random_below(4) == 0
+                     ? (char)random_below(256)
+                     : alphabet[random_below(sizeof(alphabet) - 1)];
+
+        switch (random_below(3))
+        {
+        case 0:
+            if (length < FUZZ_SIZE)
+            {
+                memmove(text + position + 1, text + position,
+                        length - position);
+                text[position] = c;
+                length++;
+            }
+            break;
+        case 1:
+            if (position < length)
+                text[position] = c;
+            break;
+        default:
+            if (position < length)
+            {
+                memmove(text + position, text + position + 1,
+                        length - position - 1);
+                length--;
+            }
+            break;
+        }
+    }
+    return length;
+}
+
+static void fuzz(long inputs, unsigned long seed)
+{
+    char text[FUZZ_SIZE + 64];
+    Input_value values[FUZZ_VALUES_MAX];
+    Parse_result result;
+    size_t length;
+    long parsed_back = 0;
+    int count;
+
+    random_state = seed != 0 ? seed : 1;
+    for (long i = 0; i < inputs; i++)
+    {
+        /* Generated values are parsed back */
+        alarm(FUZZ_TIMEOUT);
+        count = 1 + random_below(FUZZ_VALUES_MAX);
+        length = 0;
+        for (int j = 0; j < count; j++)
+            length = generate_value(text, length, &values[j]);
+        result = parse_split(text, length, '9');
+        if (!result.expected || result.count != count ||
+            !same_value(result.newest, values[count - 1]))
+            report("values not parsed back", text, length);
+        parsed_back += count;
+
+        /* Anything else is at least parsed consistently */
+        check_input(text, length);
+        length = mutate(text, length);
+        check_input(text, length);
+    }
+    alarm(0);
+
+    printf("Info: %ld inputs fuzzed from seed %lu, %ld values parsed "
+           "back.\n",
+           inputs, seed, parsed_back);
+}
+
+/* Parse the standard input as read_input() would, e.g. the output of
+ * xob-replay, and fail on unexpected input */
+static void check_stream(void)
+{
+    Input_buffer buffer = {.length = 0, .trace = NULL};
+    Input_value newest;
+    ssize_t length;
+    long values = 0;
+    int count;
+
+    do
+    {
+        length = read(STDIN_FILENO, buffer.data + buffer.length,
+                      INPUT_BUFFER_SIZE - buffer.length);
+        if (length > 0)
+            buffer.length += length;
+        if (!parse_input(&buffer, length <= 0, &styles, &newest, &count))
+        {
+            fprintf(stderr, "Error: unexpected input after %ld values.\n",
+                    values + count);
+            exit(EXIT_FAILURE);
+        }
+        values += count;
+    } while (length > 0);
+
+    printf("Info: %ld values parsed.\n", values);
+}
+
+#ifdef XOB_LIBFUZZER
+
+/* Entry point of libFuzzer (clang -fsanitize=fuzzer) */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (styles.count == 0)
+    {
+        style_index_init(&styles, style_names, STYLES_COUNT);
+        styles.warn = false;
+    }
+    random_state = size + 1;
+    check_input((const char *)data, size < FUZZ_SIZE ? size : FUZZ_SIZE);
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+    long inputs = 0;
+    unsigned long seed = time(NULL);
+    bool single = false;
+    bool stream = false;
+    char input[FUZZ_SIZE];
+    size_t size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "z:s:ich")) != -1)
+    {
+        switch (opt)
+        {
+        case 'z':
+            inputs = atol(optarg);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'i':
+            single = true;
+            break;
+        case 'c':
+            stream = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-z inputs [-s seed] | -i | -c]\n\n",
+                    argv[0]);
+            fprintf(stderr, "    -z  fuzz the parser with that many random "
+                            "inputs instead of measuring it\n");
+            fprintf(stderr, "    -s  seed of the random inputs\n");
+            fprintf(stderr, "    -i  check the input read on the standard "
+                            "input (e.g. for afl-fuzz)\n");
+            fprintf(stderr, "    -c  parse the standard input as xob would "
+                            "and fail on unexpected input\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* Unknown styles are part of the fuzzing */
+    style_index_init(&styles, style_names, STYLES_COUNT);
+    styles.warn = false;
+
+    if (stream)
+        check_stream();
+    else if (single)
+    {
+        size = fread(input, 1, FUZZ_SIZE, stdin);
+        check_input(input, size);
+    }
+    else if (inputs > 0)
+        fuzz(inputs, seed);
+    else
+        benchmark();
+    return EXIT_SUCCESS;
+}
+
+#endif
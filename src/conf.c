@@ -82,6 +82,119 @@ static int config_setting_lookup_dim(const config_setting_t *setting,
     return success_status;
 }
 
+static int config_setting_lookup_fps(const config_setting_t *setting,
+                                     const char *name, int *value)
+{
+    int fps;
+    int success_status = config_setting_lookup_int(setting, name, &fps);
+
+    if (success_status == CONFIG_TRUE)
+    {
+        if (fps < 0)
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Negative maximum frame rate.\n",
+                    config_setting_source_line(
+                        config_setting_get_member(setting, name)));
+            success_status = CONFIG_FALSE;
+        }
+        else
+            *value = fps;
+    }
+
+    return success_status;
+}
+
+static int config_setting_lookup_release(const config_setting_t *setting,
+                                         const char *name, int *value)
+{
+    int release;
+    int success_status = config_setting_lookup_int(setting, name, &release);
+
+    if (success_status == CONFIG_TRUE)
+    {
+        if (release < 0)
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Negative release delay.\n",
+                    config_setting_source_line(
+                        config_setting_get_member(setting, name)));
+            success_status = CONFIG_FALSE;
+        }
+        else
+            *value = release;
+    }
+
+    return success_status;
+}
+
+static int config_setting_lookup_history(const config_setting_t *setting,
+                                         const char *name,
+                                         History_style *value)
+{
+    config_setting_t *history_setting;
+    History_style history = *value;
+    int success_status = CONFIG_FALSE;
+
+    history_setting = config_setting_get_member(setting, name);
+
+    if (history_setting != NULL)
+    {
+        config_setting_lookup_int(history_setting, "samples",
+                                  &history.samples);
+        config_setting_lookup_int(history_setting, "column", &history.column);
+
+        if (history.samples < 0 || history.column <= 0)
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Expected a natural number of samples and a non-zero "
+                    "column width.\n",
+                    config_setting_source_line(history_setting));
+        }
+        else
+        {
+            *value = history;
+            success_status = CONFIG_TRUE;
+        }
+    }
+
+    return success_status;
+}
+
+static int config_setting_lookup_radii(const config_setting_t *setting,
+                                       const char *name, Radii *value)
+{
+    config_setting_t *radii_setting;
+    int success_status = CONFIG_FALSE;
+
+    radii_setting = config_setting_get_member(setting, name);
+
+    if (radii_setting != NULL)
+    {
+        success_status = CONFIG_TRUE;
+        config_setting_lookup_int(radii_setting, "outline", &value->outline);
+        config_setting_lookup_int(radii_setting, "border", &value->border);
+        config_setting_lookup_int(radii_setting, "content", &value->content);
+
+        if (value->outline < 0 || value->border < 0 || value->content < 0)
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Negative radius.\n",
+                    config_setting_source_line(radii_setting));
+            value->outline = value->outline < 0 ? 0 : value->outline;
+            value->border = value->border < 0 ? 0 : value->border;
+            value->content = value->content < 0 ? 0 : value->content;
+            success_status = CONFIG_FALSE;
+        }
+    }
+
+    return success_status;
+}
+
 static inline bool color_spec_is_valid(const char *spec)
 {
     if (spec[0] == '#' && (strlen(spec) == 7 || strlen(spec) == 9))
@@ -144,6 +257,50 @@ static int config_setting_lookup_color(const config_setting_t *setting,
     return success_status;
 }
 
+/* A paint is either a color or a gradient given as an array of two colors */
+static int config_setting_lookup_paint(const config_setting_t *setting,
+                                       const char *name, Color *value,
+                                       bool *gradient, Color *end)
+{
+    config_setting_t *paint_setting;
+    const char *start_string;
+    const char *end_string;
+    int success_status = CONFIG_FALSE;
+
+    paint_setting = config_setting_get_member(setting, name);
+
+    if (paint_setting == NULL || !config_setting_is_array(paint_setting))
+    {
+        success_status = config_setting_lookup_color(setting, name, value);
+        if (success_status)
+            *gradient = false;
+    }
+    else
+    {
+        start_string = config_setting_get_string_elem(paint_setting, 0);
+        end_string = config_setting_get_string_elem(paint_setting, 1);
+
+        if (config_setting_length(paint_setting) == 2 && start_string != NULL &&
+            end_string != NULL && color_spec_is_valid(start_string) &&
+            color_spec_is_valid(end_string))
+        {
+            *value = parse_color(start_string);
+            *end = parse_color(end_string);
+            *gradient = true;
+            success_status = CONFIG_TRUE;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Invalid gradient specification. Expected two colors.\n",
+                    config_setting_source_line(paint_setting));
+        }
+    }
+
+    return success_status;
+}
+
 static int config_setting_lookup_colors(const config_setting_t *setting,
                                         const char *name, Colors *value)
 {
@@ -154,12 +311,20 @@ static int config_setting_lookup_colors(const config_setting_t *setting,
 
     if (colorspec_setting != NULL)
     {
-        success_status = config_setting_lookup_color(colorspec_setting, "fg",
-                                                     &(value->fg)) &&
-                         config_setting_lookup_color(colorspec_setting, "bg",
-                                                     &(value->bg)) &&
-                         config_setting_lookup_color(
-                             colorspec_setting, "border", &(value->border));
+        success_status =
+            config_setting_lookup_paint(colorspec_setting, "fg", &(value->fg),
+                                        &(value->fg_gradient),
+                                        &(value->fg_end)) &&
+            config_setting_lookup_paint(colorspec_setting, "bg", &(value->bg),
+                                        &(value->bg_gradient),
+                                        &(value->bg_end)) &&
+            config_setting_lookup_color(colorspec_setting, "border",
+                                        &(value->border));
+
+        /* The label color is optional and defaults to the border color */
+        if (success_status && !config_setting_lookup_color(
+                                  colorspec_setting, "label", &(value->label)))
+            value->label = value->border;
     }
 
     return success_status;
@@ -216,12 +381,17 @@ static int config_setting_lookup_orientation(const config_setting_t *setting,
             *value = VERTICAL;
             success_status = CONFIG_TRUE;
         }
+        else if (strcmp(stringvalue, "radial") == 0)
+        {
+            *value = RADIAL;
+            success_status = CONFIG_TRUE;
+        }
         else
         {
             fprintf(stderr,
                     "Error: in configuration, line %d - "
-                    "Invalid orientation. Expected \"horizontal\" or "
-                    "\"vertical\".\n",
+                    "Invalid orientation. Expected \"horizontal\", "
+                    "\"vertical\" or \"radial\".\n",
                     config_setting_source_line(setting));
         }
     }
@@ -229,48 +399,201 @@ static int config_setting_lookup_orientation(const config_setting_t *setting,
     return success_status;
 }
 
-Style parse_style_config(FILE *file, const char *stylename, Style default_style)
+static int config_setting_lookup_segments(const config_setting_t *setting,
+                                          const char *name,
+                                          Segments_style *value)
 {
-    config_t config;
-    config_init(&config);
+    config_setting_t *segments_setting;
+    Segments_style segments = *value;
+    int success_status = CONFIG_FALSE;
 
-    config_setting_t *xob_config;
-    config_setting_t *color_config;
-    Style style = default_style;
+    segments_setting = config_setting_get_member(setting, name);
 
-    if (config_read(&config, file))
+    if (segments_setting != NULL)
     {
-        xob_config = config_lookup(&config, stylename);
-        if (xob_config != NULL)
+        config_setting_lookup_int(segments_setting, "count", &segments.count);
+        config_setting_lookup_int(segments_setting, "gap", &segments.gap);
+
+        if (segments.count < 0 || segments.gap < 0)
+        {
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Expected a natural number of segments and a natural "
+                    "gap.\n",
+                    config_setting_source_line(segments_setting));
+        }
+        else
+        {
+            *value = segments;
+            success_status = CONFIG_TRUE;
+        }
+    }
+
+    return success_status;
+}
+
+static int config_setting_lookup_label(const config_setting_t *setting,
+                                       const char *name, Label_style *value)
+{
+    config_setting_t *label_setting;
+    const char *stringvalue;
+    int success_status = CONFIG_FALSE;
+
+    label_setting = config_setting_get_member(setting, name);
+
+    if (label_setting != NULL)
+    {
+        success_status = CONFIG_TRUE;
+
+        if (config_setting_lookup_string(label_setting, "position",
+                                         &stringvalue))
         {
-            config_setting_lookup_int(xob_config, "thickness",
-                                      &style.thickness);
-            config_setting_lookup_int(xob_config, "border", &style.border);
-            config_setting_lookup_int(xob_config, "padding", &style.padding);
-            config_setting_lookup_int(xob_config, "outline", &style.outline);
-            config_setting_lookup_dim(xob_config, "x", &style.x);
-            config_setting_lookup_dim(xob_config, "y", &style.y);
-            config_setting_lookup_dim(xob_config, "length", &style.length);
-            config_setting_lookup_orientation(xob_config, "orientation",
-                                              &style.orientation);
-            config_setting_lookup_overflowmode(xob_config, "overflow",
-                                               &style.overflow);
-            color_config = config_setting_get_member(xob_config, "color");
-            if (color_config != NULL)
+            if (strcmp(stringvalue, "none") == 0)
+                value->position = NO_LABEL;
+            else if (strcmp(stringvalue, "inside") == 0)
+                value->position = INSIDE;
+            else if (strcmp(stringvalue, "outside") == 0)
+                value->position = OUTSIDE;
+            else
+            {
+                fprintf(stderr,
+                        "Error: in configuration, line %d - "
+                        "Invalid label position. Expected \"none\", "
+                        "\"inside\", or \"outside\".\n",
+                        config_setting_source_line(label_setting));
+                success_status = CONFIG_FALSE;
+            }
+        }
+
+        if (config_setting_lookup_string(label_setting, "font", &stringvalue))
+        {
+            if (strlen(stringvalue) < LABEL_FONT_SIZE)
+                strcpy(value->font, stringvalue);
+            else
             {
-                config_setting_lookup_colors(color_config, "normal",
-                                             &style.colorscheme.normal);
-                config_setting_lookup_colors(color_config, "overflow",
-                                             &style.colorscheme.overflow);
-                config_setting_lookup_colors(color_config, "alt",
-                                             &style.colorscheme.alt);
-                config_setting_lookup_colors(color_config, "altoverflow",
-                                             &style.colorscheme.altoverflow);
+                fprintf(stderr,
+                        "Error: in configuration, line %d - "
+                        "Font name too long.\n",
+                        config_setting_source_line(label_setting));
+                success_status = CONFIG_FALSE;
             }
         }
+    }
+
+    return success_status;
+}
+
+static int config_setting_lookup_path(const config_setting_t *setting,
+                                      const char *name, char *value)
+{
+    const char *stringvalue;
+    int success_status = CONFIG_FALSE;
+
+    if (config_setting_lookup_string(setting, name, &stringvalue))
+    {
+        if (strlen(stringvalue) < ICON_PATH_SIZE)
+        {
+            strcpy(value, stringvalue);
+            success_status = CONFIG_TRUE;
+        }
         else
         {
-            fprintf(stderr, "Error: No style %s.\n", stylename);
+            fprintf(stderr,
+                    "Error: in configuration, line %d - "
+                    "Path too long.\n",
+                    config_setting_source_line(setting));
+        }
+    }
+
+    return success_status;
+}
+
+/* Missing icons fall back on the normal icon (or the alt icon for
+ * altoverflow) */
+static int config_setting_lookup_iconset(const config_setting_t *setting,
+                                         const char *name, Iconset *value)
+{
+    config_setting_t *iconset_setting;
+    int success_status = CONFIG_FALSE;
+
+    iconset_setting = config_setting_get_member(setting, name);
+
+    if (iconset_setting != NULL)
+    {
+        success_status = config_setting_lookup_path(iconset_setting, "normal",
+                                                    value->normal);
+        if (!config_setting_lookup_path(iconset_setting, "overflow",
+                                        value->overflow))
+            strcpy(value->overflow, value->normal);
+        if (!config_setting_lookup_path(iconset_setting, "alt", value->alt))
+            strcpy(value->alt, value->normal);
+        if (!config_setting_lookup_path(iconset_setting, "altoverflow",
+                                        value->altoverflow))
+            strcpy(value->altoverflow, value->alt);
+    }
+
+    return success_status;
+}
+
+/* Read a style from its setting in the configuration */
+static Style style_from_setting(config_setting_t *xob_config, Style style)
+{
+    config_setting_t *color_config;
+
+    config_setting_lookup_int(xob_config, "thickness", &style.thickness);
+    config_setting_lookup_int(xob_config, "border", &style.border);
+    config_setting_lookup_int(xob_config, "padding", &style.padding);
+    config_setting_lookup_int(xob_config, "outline", &style.outline);
+    config_setting_lookup_radii(xob_config, "radius", &style.radius);
+    config_setting_lookup_dim(xob_config, "x", &style.x);
+    config_setting_lookup_dim(xob_config, "y", &style.y);
+    config_setting_lookup_dim(xob_config, "length", &style.length);
+    config_setting_lookup_orientation(xob_config, "orientation",
+                                      &style.orientation);
+    config_setting_lookup_overflowmode(xob_config, "overflow",
+                                       &style.overflow);
+    config_setting_lookup_fps(xob_config, "max_fps", &style.max_fps);
+    config_setting_lookup_release(xob_config, "release", &style.release);
+    config_setting_lookup_history(xob_config, "history", &style.history);
+    config_setting_lookup_segments(xob_config, "segments", &style.segments);
+    config_setting_lookup_label(xob_config, "label", &style.label);
+    config_setting_lookup_iconset(xob_config, "icon", &style.iconset);
+    color_config = config_setting_get_member(xob_config, "color");
+    if (color_config != NULL)
+    {
+        config_setting_lookup_colors(color_config, "normal",
+                                     &style.colorscheme.normal);
+        config_setting_lookup_colors(color_config, "overflow",
+                                     &style.colorscheme.overflow);
+        config_setting_lookup_colors(color_config, "alt",
+                                     &style.colorscheme.alt);
+        config_setting_lookup_colors(color_config, "altoverflow",
+                                     &style.colorscheme.altoverflow);
+    }
+
+    return style;
+}
+
+void parse_style_configs(FILE *file, const char *stylenames[], int count,
+                         Style default_style, Style styles[])
+{
+    config_t config;
+    config_init(&config);
+
+    config_setting_t *xob_config;
+
+    for (int i = 0; i < count; i++)
+        styles[i] = default_style;
+
+    if (config_read(&config, file))
+    {
+        for (int i = 0; i < count; i++)
+        {
+            xob_config = config_lookup(&config, stylenames[i]);
+            if (xob_config != NULL)
+                styles[i] = style_from_setting(xob_config, default_style);
+            else
+                fprintf(stderr, "Error: No style %s.\n", stylenames[i]);
         }
     }
     else
@@ -280,5 +603,12 @@ Style parse_style_config(FILE *file, const char *stylename, Style default_style)
     }
 
     config_destroy(&config);
+}
+
+Style parse_style_config(FILE *file, const char *stylename, Style default_style)
+{
+    Style style;
+
+    parse_style_configs(file, &stylename, 1, default_style, &style);
     return style;
 }
@@ -18,6 +18,7 @@
 #ifndef CONF_H
 #define CONF_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
 typedef struct
@@ -33,6 +34,13 @@ typedef struct
     Color fg;
     Color bg;
     Color border;
+    Color label;
+    /* Optional linear gradients from fg (resp. bg) to these colors along the
+     * direction in which the bar fills up */
+    bool fg_gradient;
+    Color fg_end;
+    bool bg_gradient;
+    Color bg_end;
 } Colors;
 
 typedef struct
@@ -58,9 +66,62 @@ typedef enum
 typedef enum
 {
     HORIZONTAL,
-    VERTICAL
+    VERTICAL,
+    /* A ring filled clockwise along an arc, as a speedometer */
+    RADIAL
 } Orientation;
 
+typedef enum
+{
+    NO_LABEL,
+    INSIDE,
+    OUTSIDE
+} Label_position;
+
+#define LABEL_FONT_SIZE 256
+
+typedef struct
+{
+    Label_position position;
+    char font[LABEL_FONT_SIZE];
+} Label_style;
+
+/* Radii of the corners of the outer edges of the outline and the border, and
+ * of the inside of the bar */
+typedef struct
+{
+    int outline;
+    int border;
+    int content;
+} Radii;
+
+#define ICON_PATH_SIZE 1024
+
+/* Paths to the image files of the icons of each color set, empty if none */
+typedef struct
+{
+    char normal[ICON_PATH_SIZE];
+    char overflow[ICON_PATH_SIZE];
+    char alt[ICON_PATH_SIZE];
+    char altoverflow[ICON_PATH_SIZE];
+} Iconset;
+
+/* History mode: the last samples are displayed as a graph, one column each.
+ * Disabled if there are no samples. */
+typedef struct
+{
+    int samples;
+    int column;
+} History_style;
+
+/* Segmented mode: the bar is made of segments separated by gaps, lit as the
+ * value grows. Disabled if there are no segments. */
+typedef struct
+{
+    int count;
+    int gap;
+} Segments_style;
+
 typedef struct
 {
     Dim x;
@@ -70,8 +131,17 @@ typedef struct
     int border;
     int padding;
     int outline;
+    Radii radius;
     Orientation orientation;
     Overflow_mode overflow;
+    /* Maximum number of frames rendered per second, 0 if unlimited */
+    int max_fps;
+    /* Milliseconds a hidden bar keeps its window, 0 if forever */
+    int release;
+    History_style history;
+    Segments_style segments;
+    Label_style label;
+    Iconset iconset;
     Colorscheme colorscheme;
 } Style;
 
@@ -98,6 +168,23 @@ typedef struct
         .outline = 3,\
         .orientation = VERTICAL,\
         .overflow = PROPORTIONAL,\
+        .max_fps = 0,\
+        .release = 0,\
+        .history =\
+        {\
+            .samples = 0,\
+            .column = 2\
+        },\
+        .segments =\
+        {\
+            .count = 0,\
+            .gap = 2\
+        },\
+        .label =\
+        {\
+            .position = NO_LABEL,\
+            .font = "fixed"\
+        },\
         .colorscheme =\
         {\
             .normal =\
@@ -117,6 +204,13 @@ typedef struct
                     .alpha = 0x90\
                 },\
                 .border = \
+                { \
+                    .red   = 0xff,\
+                    .green = 0xff,\
+                    .blue  = 0xff,\
+                    .alpha = 0xff\
+                },\
+                .label = \
                 { \
                     .red   = 0xff,\
                     .green = 0xff,\
@@ -141,6 +235,13 @@ typedef struct
                     .alpha = 0x90\
                 },\
                 .border = \
+                { \
+                    .red   = 0xff,\
+                    .green = 0x00,\
+                    .blue  = 0x00,\
+                    .alpha = 0xff\
+                },\
+                .label = \
                 { \
                     .red   = 0xff,\
                     .green = 0x00,\
@@ -165,6 +266,13 @@ typedef struct
                     .alpha = 0x90\
                 },\
                 .border = \
+                { \
+                    .red   = 0x55,\
+                    .green = 0x55,\
+                    .blue  = 0x55,\
+                    .alpha = 0xff\
+                },\
+                .label = \
                 { \
                     .red   = 0x55,\
                     .green = 0x55,\
@@ -189,6 +297,13 @@ typedef struct
                     .alpha = 0x90\
                 },\
                 .border = \
+                { \
+                    .red   = 0x55,\
+                    .green = 0x00,\
+                    .blue  = 0x00,\
+                    .alpha = 0xff\
+                },\
+                .label = \
                 { \
                     .red   = 0x55,\
                     .green = 0x00,\
@@ -207,4 +322,8 @@ typedef struct
 Style parse_style_config(FILE *filename, const char *stylename,
                          Style default_style);
 
+/* Read several styles from a configuration file parsed once */
+void parse_style_configs(FILE *file, const char *stylenames[], int count,
+                         Style default_style, Style styles[]);
+
 #endif /* __CONF_H__ */
@@ -19,9 +19,34 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Gap between an outside label or an icon and the edges of its area */
+#define LABEL_MARGIN 4
+#define ICON_MARGIN 4
+/* An outside label of a horizontal bar is wide enough for this text */
+#define LABEL_WIDEST_TEXT "100%"
+#define PI 3.14159265358979323846
+/* Stands for the window of a renderer that needs no display */
+#define HEADLESS_WINDOW 1
+
+/* Renderers built in, from the preferred one */
+static const Renderer *const renderers[] = {
+#ifdef ENABLE_ALPHA
+    &xrender_renderer,
+#endif
+    &xlib_renderer,
+    &null_renderer,
+};
+#define RENDERERS_COUNT (sizeof(renderers) / sizeof(renderers[0]))
+
+/* The screen a renderer that needs no display pretends to draw on */
+static Screen headless_screen = {.width = HEADLESS_WIDTH,
+                                 .height = HEADLESS_HEIGHT};
+
 /* Keep value in range */
 static int fit_in(int value, int min, int max)
 {
@@ -33,65 +58,684 @@ static int fit_in(int value, int min, int max)
 /* Horizontal and vertical size depending on orientation */
 static int size_x(Geometry_context g)
 {
-    return g.orientation == HORIZONTAL ? g.length : g.thickness;
+    return g.orientation != VERTICAL ? g.length : g.thickness;
 }
 static int size_y(Geometry_context g)
 {
     return g.orientation == HORIZONTAL ? g.thickness : g.length;
 }
 
+/* Size of the bar and of its icon and outside label if any, placed on the
+ * right of a radial gauge */
+static int window_size_x(Geometry_context g)
+{
+    return 2 * (g.outline + g.border + g.padding) + size_x(g) +
+           (g.orientation != VERTICAL ? g.icon_length + g.label_length : 0);
+}
+static int window_size_y(Geometry_context g)
+{
+    return 2 * (g.outline + g.border + g.padding) + size_y(g) +
+           (g.orientation != VERTICAL ? 0 : g.icon_length + g.label_length);
+}
+
+/* Area of the given length past the edge of the bar, starting at a given
+ * distance from that edge */
+static void area_past_bar(Geometry_context g, int distance, int length,
+                          int *x, int *y, int *w, int *h)
+{
+    int fat_layer = g.outline + g.border + g.padding;
+
+    *x = g.orientation != VERTICAL ? size_x(g) + 2 * fat_layer + distance
+                                   : 0;
+    *y = g.orientation != VERTICAL ? 0 : size_y(g) + 2 * fat_layer + distance;
+    *w = g.orientation != VERTICAL ? length : size_x(g) + 2 * fat_layer;
+    *h = g.orientation != VERTICAL ? size_y(g) + 2 * fat_layer : length;
+}
+
+/* A rectangle of the given size, position and color */
+static Primitive rectangle(int x, int y, unsigned int w, unsigned int h,
+                           Paint paint)
+{
+    return (Primitive){
+        .x = x, .y = y, .w = w, .h = h, .paint = paint, .mask = NO_MASK};
+}
+
+static Bool is_rounded(Geometry_context g)
+{
+    return g.outline_radius > 0 || g.border_radius > 0 ||
+           g.content_radius > 0;
+}
+
+/* The same rectangle as a part of a layer of the bar */
+static Primitive layer(Geometry_context g, Primitive p, int mask)
+{
+    p.mask = is_rounded(g) ? mask : NO_MASK;
+    return p;
+}
+
+/* A rectangle covering the [start, end[ range of the inside of the bar,
+ * measured from where it starts filling up (left or bottom), and the
+ * [from, to[ range across it, measured from the bottom of a horizontal bar or
+ * the left of a vertical bar. Empty ranges give the same null primitive
+ * whatever their position and color. */
+static Primitive area(Geometry_context g, int start, int end, int from, int to,
+                      Paint paint)
+{
+    int fat_layer = g.outline + g.border + g.padding;
+
+    start = fit_in(start, 0, g.length);
+    end = fit_in(end, 0, g.length);
+    from = fit_in(from, 0, g.thickness);
+    to = fit_in(to, 0, g.thickness);
+
+    if (end <= start || to <= from)
+        return (Primitive){0};
+    else if (g.orientation == HORIZONTAL)
+        return layer(g,
+                     rectangle(fat_layer + start,
+                               fat_layer + g.thickness - to, end - start,
+                               to - from, paint),
+                     CONTENT_MASK);
+    else
+        return layer(g,
+                     rectangle(fat_layer + from, fat_layer + g.length - end,
+                               to - from, end - start, paint),
+                     CONTENT_MASK);
+}
+
+/* The [start, end[ range of the inside of the bar across its thickness */
+static Primitive segment(Geometry_context g, int start, int end, Paint paint)
+{
+    return area(g, start, end, 0, g.thickness, paint);
+}
+
+/* The segments of the ring of a radial gauge covering the [start, end[
+ * range of its length */
+static Primitive arc(Geometry_context g, int start, int end, Paint paint)
+{
+    int fat_layer = g.outline + g.border + g.padding;
+    int first;
+    int last;
+    Primitive p = rectangle(fat_layer, fat_layer, g.length, g.length, paint);
+
+    if (g.length <= 0)
+        return (Primitive){0};
+    first = fit_in(start, 0, g.length) * GAUGE_SEGMENTS / g.length;
+    last = fit_in(end, 0, g.length) * GAUGE_SEGMENTS / g.length;
+    if (last <= first)
+        return (Primitive){0};
+    p.arc_first = first;
+    p.arc_last = last;
+    return p;
+}
+
 /* Draw an empty bar with the given colors */
-static void draw_empty(X_context x, Geometry_context g, Colors colors)
+static void draw_empty(Display_list *dl, Geometry_context g, Paints paints)
 {
     /* Outline */
-    fill_rectangle(x, colors.bg, 0, 0,
-                   2 * (g.outline + g.border + g.padding) + size_x(g),
-                   2 * (g.outline + g.border + g.padding) + size_y(g));
+    dl->primitives[0] = layer(
+        g,
+        rectangle(0, 0, 2 * (g.outline + g.border + g.padding) + size_x(g),
+                  2 * (g.outline + g.border + g.padding) + size_y(g),
+                  paints.bg),
+        OUTLINE_MASK);
     /* Border */
-    fill_rectangle(x, colors.border, g.outline, g.outline,
-                   2 * (g.border + g.padding) + size_x(g),
-                   2 * (g.border + g.padding) + size_y(g));
+    dl->primitives[1] = layer(
+        g,
+        rectangle(g.outline, g.outline, 2 * (g.border + g.padding) + size_x(g),
+                  2 * (g.border + g.padding) + size_y(g), paints.border),
+        BORDER_MASK);
     /* Padding */
-    fill_rectangle(x, colors.bg, g.outline + g.border, g.outline + g.border,
-                   2 * g.padding + size_x(g), 2 * g.padding + size_y(g));
+    dl->primitives[2] = layer(
+        g,
+        rectangle(g.outline + g.border, g.outline + g.border,
+                  2 * g.padding + size_x(g), 2 * g.padding + size_y(g),
+                  paints.bg),
+        PADDING_MASK);
 }
 
-/* Draw a given length of filled bar with the given color */
-static void draw_content(X_context x, Geometry_context g, int filled_length,
-                         Color color)
+/* Draw a given length of filled bar with the given colors, the remaining
+ * length being the background */
+static void draw_content(Display_list *dl, Geometry_context g,
+                         int filled_length, Paints paints)
 {
-    if (g.orientation == HORIZONTAL)
+    Primitive *content = dl->primitives + DISPLAY_LIST_FRAME_SIZE;
+
+    /* The filled arc over the inside of a radial gauge, which is its
+     * background */
+    if (g.orientation == RADIAL)
+    {
+        content[0] = segment(g, 0, g.length, paints.bg);
+        content[1] = arc(g, 0, filled_length, paints.fg);
+        content[2] = (Primitive){0};
+        content[3] = (Primitive){0};
+        return;
+    }
+
+    content[0] = segment(g, 0, filled_length, paints.fg);
+    content[1] = (Primitive){0};
+    content[2] = (Primitive){0};
+    content[3] = segment(g, filled_length, g.length, paints.bg);
+}
+
+/* Draw the background of a segmented bar, its gaps included, and light a
+ * given number of segments over it */
+static void draw_segments(Display_list *dl, Geometry_context g, int lit,
+                          Paints paints)
+{
+    Primitive *content = dl->primitives + DISPLAY_LIST_FRAME_SIZE;
+
+    content[0] = segment(g, 0, g.length, paints.bg);
+    content[1] = (Primitive){0};
+    content[2] = (Primitive){0};
+    content[3] = (Primitive){0};
+    dl->lit = lit;
+    dl->lit_paint = paints.fg;
+}
+
+/* Leave the inside of the bar to the history */
+static void draw_no_content(Display_list *dl)
+{
+    Primitive *content = dl->primitives + DISPLAY_LIST_FRAME_SIZE;
+
+    for (int i = 0; i < DISPLAY_LIST_CONTENT_SIZE; i++)
+        content[i] = (Primitive){0};
+}
+
+/* Draw a separator (padding-sized gap) at the given position between the
+ * proportional part and the overflowing part of the bar */
+static void draw_separator(Display_list *dl, Geometry_context g, int position,
+                           Paint proportional, Paint separator, Paint overflow)
+{
+    Primitive *content = dl->primitives + DISPLAY_LIST_FRAME_SIZE;
+    int start = position - (g.orientation != VERTICAL
+                                ? g.padding - g.padding / 2
+                                : g.padding / 2);
+
+    /* The separator of a radial gauge is a gap between two arcs */
+    if (g.orientation == RADIAL)
     {
-        fill_rectangle(x, color, g.outline + g.border + g.padding,
-                       g.outline + g.border + g.padding, filled_length,
-                       g.thickness);
+        content[0] = segment(g, 0, g.length, separator);
+        content[1] = arc(g, 0, start, proportional);
+        content[2] = arc(g, start + g.padding, g.length, overflow);
+        content[3] = (Primitive){0};
+        return;
+    }
+
+    content[0] = segment(g, 0, start, proportional);
+    content[1] = segment(g, start, start + g.padding, separator);
+    content[2] = segment(g, start + g.padding, g.length, overflow);
+    content[3] = (Primitive){0};
+}
+
+/* Draw a label showing a percentage, either centered inside the bar or in
+ * an area of its own past the edge of the bar */
+static void draw_label(Display_list *dl, Geometry_context g, XFontStruct *font,
+                       int percentage, Paints paints)
+{
+    Label *label = &dl->label;
+    Primitive *background =
+        dl->primitives + DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE;
+    int fat_layer = g.outline + g.border + g.padding;
+    int area_x;
+    int area_y;
+    int area_w;
+    int area_h;
+
+    *background = (Primitive){0};
+
+    if (g.label_position == NO_LABEL)
+    {
+        *label = (Label){0};
+        return;
+    }
+    else if (g.label_position == INSIDE)
+    {
+        area_x = fat_layer;
+        area_y = fat_layer;
+        area_w = size_x(g);
+        area_h = size_y(g);
     }
     else
     {
-        fill_rectangle(x, color, g.outline + g.border + g.padding,
-                       g.outline + g.border + g.padding + g.length -
-                           filled_length,
-                       g.thickness, filled_length);
+        area_past_bar(g, g.icon_length, g.label_length, &area_x, &area_y,
+                      &area_w, &area_h);
+        *background = rectangle(area_x, area_y, area_w, area_h, paints.bg);
     }
+
+    label->length =
+        fit_in(snprintf(label->text, LABEL_TEXT_SIZE, "%d%%", percentage), 0,
+               LABEL_TEXT_SIZE - 1);
+    label->color = paints.label;
+
+    /* Centered, or aligned on the left if it does not fit */
+    label->x = area_x +
+               fit_in((area_w - XTextWidth(font, label->text, label->length)) /
+                          2,
+                      0, area_w);
+    label->y = area_y + (area_h + font->ascent - font->descent) / 2;
+
+    /* Pixels actually drawn */
+    int direction;
+    int ascent;
+    int descent;
+    XCharStruct extents;
+    XTextExtents(font, label->text, label->length, &direction, &ascent,
+                 &descent, &extents);
+    label->box_x = label->x + extents.lbearing;
+    label->box_y = label->y - extents.ascent;
+    label->box_w = extents.rbearing - extents.lbearing;
+    label->box_h = extents.ascent + extents.descent;
 }
 
-/* Draw a separator (padding-sized gap) at the given position */
-static void draw_separator(X_context x, Geometry_context g, int position,
-                           Color color)
+/* Draw the icon of the color set centered in its area past the edge of the
+ * bar */
+static void draw_icon_area(Display_list *dl, Geometry_context g,
+                           const Image *icons, Paints paints)
 {
-    if (g.orientation == HORIZONTAL)
+    Primitive *background = dl->primitives + DISPLAY_LIST_FRAME_SIZE +
+                            DISPLAY_LIST_CONTENT_SIZE + DISPLAY_LIST_LABEL_SIZE;
+    int area_x;
+    int area_y;
+    int area_w;
+    int area_h;
+
+    *background = (Primitive){0};
+    dl->icon = (Icon){.index = NO_ICON, .x = 0, .y = 0};
+
+    if (g.icon_length > 0)
     {
-        fill_rectangle(
-            x, color, g.outline + g.border + (g.padding / 2) + position,
-            g.outline + g.border + g.padding, g.padding, g.thickness);
+        area_past_bar(g, 0, g.icon_length, &area_x, &area_y, &area_w,
+                      &area_h);
+        *background = rectangle(area_x, area_y, area_w, area_h, paints.bg);
+
+        if (paints.icon != NO_ICON)
+            dl->icon = (Icon){
+                .index = paints.icon,
+                .x = area_x + (area_w - icons[paints.icon].width) / 2,
+                .y = area_y + (area_h - icons[paints.icon].height) / 2};
+    }
+}
+
+static Bool same_color(Color a, Color b)
+{
+    return a.red == b.red && a.green == b.green && a.blue == b.blue &&
+           a.alpha == b.alpha;
+}
+
+static Bool same_primitive(Primitive a, Primitive b)
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h &&
+           a.paint.gradient == b.paint.gradient &&
+           same_color(a.paint.color, b.paint.color) && a.mask == b.mask &&
+           a.arc_first == b.arc_first && a.arc_last == b.arc_last;
+}
+
+/* Whether a rectangle overlaps the corners of the inside of the bar, where
+ * the coverage of the content layer may be partial */
+static Bool touches_inner_corner(Geometry_context g, Primitive p)
+{
+    int fat_layer = g.outline + g.border + g.padding;
+    int corner = g.content_radius;
+
+    int outer[3] = {g.padding_radius - g.padding,
+                    g.border_radius - g.border - g.padding,
+                    g.outline_radius - fat_layer};
+
+    /* Corners of outer layers may reach the inside of the bar */
+    for (int i = 0; i < 3; i++)
+        corner = outer[i] > corner ? outer[i] : corner;
+
+    return (p.x < fat_layer + corner ||
+            p.x + (int)p.w > fat_layer + size_x(g) - corner) &&
+           (p.y < fat_layer + corner ||
+            p.y + (int)p.h > fat_layer + size_y(g) - corner);
+}
+
+/* Submit a primitive. Layers of a bar with rounded corners are drawn over
+ * each other when the whole bar is submitted. A part of the content layer
+ * alone is drawn over the layers of the frame where it overlaps the
+ * corners. */
+static int submit_primitive(X_context x, Geometry_context g, Primitive p,
+                            Bool whole, const Primitive frame[])
+{
+    if (p.arc_first < p.arc_last)
+    {
+        x.renderer->fill_arc(x, p.paint, p.arc_first, p.arc_last);
+        return 1;
+    }
+    else if (p.mask == NO_MASK)
+    {
+        if (p.paint.gradient == NO_GRADIENT)
+            x.renderer->fill_rectangle(x, p.paint.color, p.x, p.y, p.w, p.h);
+        else
+            x.renderer->fill_gradient(x, p.paint.gradient, p.x, p.y, p.w,
+                                      p.h);
+        return 1;
+    }
+    else if (whole)
+    {
+        x.renderer->fill_layer(x, p.paint, p.mask, p.mask == OUTLINE_MASK, p.x,
+                               p.y, p.w, p.h);
+        return 1;
+    }
+    else if (touches_inner_corner(g, p))
+    {
+        for (int i = 0; i < DISPLAY_LIST_FRAME_SIZE; i++)
+            x.renderer->fill_layer(x, frame[i].paint, frame[i].mask, i == 0,
+                                   p.x, p.y, p.w, p.h);
+        x.renderer->fill_layer(x, p.paint, p.mask, False, p.x, p.y, p.w, p.h);
+        return DISPLAY_LIST_FRAME_SIZE + 1;
     }
     else
     {
-        fill_rectangle(x, color, g.outline + g.border + g.padding,
-                       g.outline + g.border + (g.padding / 2) + g.length -
-                           position,
-                       g.thickness, g.padding);
+        x.renderer->fill_layer(x, p.paint, p.mask, True, p.x, p.y, p.w, p.h);
+        return 1;
+    }
+}
+
+static Bool same_icon(Icon a, Icon b)
+{
+    return a.index == b.index && a.x == b.x && a.y == b.y;
+}
+
+/* Whether an overlay drawn over the slots [first, last[ must be drawn again.
+ * These slots are marked for submission if the overlay changed. */
+static Bool overlay(Bool *submit, int first, int last, Bool changed)
+{
+    for (int i = first; i < last; i++)
+    {
+        if (changed)
+            submit[i] = True;
+        else if (submit[i])
+            return True;
     }
+    return changed;
+}
+
+/* Whether two rectangles overlap */
+static Bool overlap(int ax, int ay, unsigned int aw, unsigned int ah, int bx,
+                    int by, unsigned int bw, unsigned int bh)
+{
+    return ax < bx + (int)bw && bx < ax + (int)aw && ay < by + (int)bh &&
+           by < ay + (int)ah;
+}
+
+/* Whether a primitive overlaps the box of a label */
+static Bool under_label(Primitive p, Label label)
+{
+    return label.length > 0 && overlap(p.x, p.y, p.w, p.h, label.box_x,
+                                       label.box_y, label.box_w, label.box_h);
+}
+
+/* Rectangles of the k-th newest column of the history: its filled part and
+ * the rest of it */
+static void history_column(Geometry_context g, History history, int k,
+                           Paint background, Primitive *filled,
+                           Primitive *rest)
+{
+    int end = g.length - k * history.column;
+    int start = end - history.column;
+    Sample sample = {.filled = 0, .paint = background};
+
+    if (k < history.count)
+        sample = history.samples[(history.head - 1 - k + history.size) %
+                                 history.size];
+    *filled = area(g, start, end, 0, sample.filled, sample.paint);
+    *rest = area(g, start, end, sample.filled, g.thickness, background);
+}
+
+/* Where a column of the history was before being shifted */
+static Primitive unshifted(Geometry_context g, History history, Primitive p)
+{
+    if (g.orientation == HORIZONTAL)
+        p.x += history.column;
+    else
+        p.y -= history.column;
+    return p;
+}
+
+/* Draw the history inside the bar. Unless the whole bar is drawn again, the
+ * columns are shifted by one on the X server and only the new column is
+ * drawn, as well as the ones whose corners must be shaped again (those that
+ * are or were in the corners) and those under an inside label. Returns the
+ * number of submitted requests. */
+static int present_history(X_context x, Geometry_context g, History history,
+                           Bool whole, Label last_label, Label label,
+                           Paint background, const Primitive frame[])
+{
+    int fat_layer = g.outline + g.border + g.padding;
+    int columns = g.length / history.column;
+    int leftover = g.length - columns * history.column;
+    int submitted = 0;
+    Primitive parts[2];
+
+    if (whole)
+    {
+        Primitive p = segment(g, 0, leftover, background);
+        if (p.w > 0 && p.h > 0)
+            submitted += submit_primitive(x, g, p, whole, frame);
+    }
+    else if (columns > 1)
+    {
+        /* Towards the oldest end of the bar, along with the label */
+        if (g.orientation == HORIZONTAL)
+        {
+            x.renderer->copy_area(x, fat_layer + leftover + history.column,
+                                  fat_layer, (columns - 1) * history.column,
+                                  g.thickness, fat_layer + leftover,
+                                  fat_layer);
+            last_label.box_x -= history.column;
+        }
+        else
+        {
+            x.renderer->copy_area(x, fat_layer, fat_layer, g.thickness,
+                                  (columns - 1) * history.column, fat_layer,
+                                  fat_layer + history.column);
+            last_label.box_y += history.column;
+        }
+        submitted++;
+    }
+
+    for (int k = 0; k < columns; k++)
+    {
+        history_column(g, history, k, background, &parts[0], &parts[1]);
+        for (int i = 0; i < 2; i++)
+        {
+            Primitive p = parts[i];
+            if (p.w > 0 && p.h > 0 &&
+                (whole || k == 0 ||
+                 (p.mask != NO_MASK &&
+                  (touches_inner_corner(g, p) ||
+                   touches_inner_corner(g, unshifted(g, history, p)))) ||
+                 (g.label_position == INSIDE &&
+                  (under_label(p, last_label) || under_label(p, label)))))
+                submitted += submit_primitive(x, g, p, whole, frame);
+        }
+    }
+
+    return submitted;
+}
+
+/* Fill the segments [first, last[ of a segmented bar, those away from the
+ * corners in a single request. Returns the number of submitted requests. */
+static int fill_segments(X_context x, Geometry_context g, Segments segments,
+                         int first, int last, Paint paint, Bool whole,
+                         const Primitive frame[])
+{
+    int square_first;
+    int square_last;
+    int submitted = 0;
+
+    if (last <= first)
+        return 0;
+
+    square_first = fit_in(segments.square_first, first, last);
+    square_last = fit_in(segments.square_last, square_first, last);
+    for (int i = first; i < last; i++)
+    {
+        if (i == square_first && square_first < square_last)
+        {
+            x.renderer->fill_rectangles(x, paint,
+                                        segments.rectangles + square_first,
+                                        square_last - square_first);
+            submitted++;
+            i = square_last - 1;
+        }
+        else
+        {
+            XRectangle r = segments.rectangles[i];
+            submitted += submit_primitive(
+                x, g,
+                layer(g, rectangle(r.x, r.y, r.width, r.height, paint),
+                      CONTENT_MASK),
+                whole, frame);
+        }
+    }
+
+    return submitted;
+}
+
+/* Draw the segments of a segmented bar. Unless its background has just been
+ * drawn again, only the segments that were lit or went out since the last
+ * presented display list are drawn. Returns the number of submitted
+ * requests. */
+static int present_segments(X_context x, Geometry_context g,
+                            Segments segments, Bool whole, Bool background,
+                            Display_list last, const Display_list *dl)
+{
+    const Primitive *content = dl->primitives + DISPLAY_LIST_FRAME_SIZE;
+    Bool same_paint = last.lit_paint.gradient == dl->lit_paint.gradient &&
+                      same_color(last.lit_paint.color, dl->lit_paint.color);
+    int lit_first;
+    int submitted = 0;
+
+    /* All the segments went out along with the background */
+    if (background)
+        last.lit = 0;
+    lit_first = same_paint ? last.lit : 0;
+
+    submitted += fill_segments(x, g, segments, lit_first, dl->lit,
+                               dl->lit_paint, whole, dl->primitives);
+    submitted += fill_segments(x, g, segments, dl->lit, last.lit,
+                               content[0].paint, whole, dl->primitives);
+    return submitted;
+}
+
+static Bool same_label(Label a, Label b)
+{
+    return a.x == b.x && a.y == b.y && a.length == b.length &&
+           strncmp(a.text, b.text, a.length) == 0 &&
+           same_color(a.color, b.color);
+}
+
+/* Submit the primitives of a display list that differ from the last
+ * presented one. When a frame layer differs, everything is submitted again
+ * since the layers are painted over each other. Otherwise the content slots
+ * being a partition, only the changed ones are submitted. The label is drawn
+ * over some slots: they are submitted again when it changes and it is drawn
+ * again when they are submitted. The history or the segments, if any, are
+ * drawn over the content slots. Returns the number of submitted requests. */
+static int present(X_context x, Geometry_context g, History history,
+                   Segments segments, Display_list last, Display_list *dl)
+{
+    Bool submit[DISPLAY_LIST_SIZE];
+    Bool submit_label;
+    Bool submit_icon;
+    int label_first;
+    int label_last;
+    int icon_first =
+        DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE +
+        DISPLAY_LIST_LABEL_SIZE;
+    int submitted = 0;
+
+    for (int i = 0; i < DISPLAY_LIST_FRAME_SIZE && last.presented; i++)
+    {
+        if (!same_primitive(last.primitives[i], dl->primitives[i]))
+            last.presented = False;
+    }
+    for (int i = 0; i < DISPLAY_LIST_SIZE; i++)
+    {
+        submit[i] = !last.presented ||
+                    !same_primitive(last.primitives[i], dl->primitives[i]);
+    }
+
+    /* The arcs of a radial gauge are blended over its background, which is
+     * drawn again first along with all of them */
+    if (g.orientation == RADIAL &&
+        overlay(submit, DISPLAY_LIST_FRAME_SIZE,
+                DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE, False))
+        overlay(submit, DISPLAY_LIST_FRAME_SIZE,
+                DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE, True);
+
+    /* Slots under the label and the icon */
+    label_first = g.label_position == INSIDE
+                      ? DISPLAY_LIST_FRAME_SIZE
+                      : DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE;
+    label_last = g.label_position == INSIDE
+                     ? DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE
+                     : DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE +
+                           DISPLAY_LIST_LABEL_SIZE;
+    submit_label = overlay(submit, label_first, label_last,
+                           !last.presented ||
+                               !same_label(last.label, dl->label));
+    /* The history moves under an inside label */
+    submit_label = submit_label ||
+                   (history.size > 0 && g.label_position == INSIDE);
+    submit_icon =
+        overlay(submit, icon_first, icon_first + DISPLAY_LIST_ICON_SIZE,
+                !last.presented || !same_icon(last.icon, dl->icon));
+
+    for (int i = 0; i < DISPLAY_LIST_SIZE; i++)
+    {
+        Primitive p = dl->primitives[i];
+        if (p.w > 0 && p.h > 0 && submit[i])
+            submitted += submit_primitive(x, g, p, !last.presented,
+                                          dl->primitives);
+    }
+    if (history.size > 0)
+        submitted += present_history(x, g, history, !last.presented,
+                                     last.label, dl->label,
+                                     dl->primitives[2].paint, dl->primitives);
+    if (segments.count > 0)
+    {
+        int lit = present_segments(x, g, segments, !last.presented,
+                                   submit[DISPLAY_LIST_FRAME_SIZE], last, dl);
+
+        /* The label is drawn over the segments */
+        submit_label =
+            submit_label || (g.label_position == INSIDE && lit > 0);
+        submitted += lit;
+    }
+    if (dl->label.length > 0 && submit_label)
+    {
+        x.renderer->draw_text(x, dl->label.color, dl->label.x, dl->label.y,
+                              dl->label.text, dl->label.length);
+        submitted++;
+    }
+    if (dl->icon.index != NO_ICON && submit_icon)
+    {
+        x.renderer->draw_icon(x, dl->icon.index, dl->icon.x, dl->icon.y);
+        submitted++;
+    }
+
+    dl->presented = True;
+    return submitted;
+}
+
+/* Half of the smallest side of the bar, shrunk by a given amount on each
+ * axis */
+static int half_side(Geometry_context g, int shrink)
+{
+    int side = size_x(g) < size_y(g) ? size_x(g) : size_y(g);
+    return (side + shrink) / 2;
+}
+
+static void free_masks(Display_context *dc)
+{
+    for (int i = 0; i < dc->masks_count; i++)
+        free(dc->masks[i].alpha);
+    dc->masks_count = 0;
 }
 
 void compute_geometry(Style conf, Display_context *dc, int *topleft_x,
@@ -104,150 +748,765 @@ void compute_geometry(Style conf, Display_context *dc, int *topleft_x,
     dc->geometry.orientation = conf.orientation;
     *fat_layer =
         dc->geometry.padding + dc->geometry.border + dc->geometry.outline;
+    dc->geometry.outline_radius = conf.radius.outline;
+    dc->geometry.border_radius = conf.radius.border;
+    dc->geometry.content_radius = conf.radius.content;
+
+    /* Room for the label */
+    dc->geometry.icon_length = 0;
+    for (int i = 0; i < dc->icons_count; i++)
+    {
+        int icon_length =
+            2 * ICON_MARGIN + (dc->geometry.orientation != VERTICAL
+                                   ? dc->icons[i].width
+                                   : dc->icons[i].height);
+        if (icon_length > dc->geometry.icon_length)
+            dc->geometry.icon_length = icon_length;
+    }
+    dc->geometry.label_position =
+        dc->x.font != NULL ? conf.label.position : NO_LABEL;
+    dc->geometry.label_length = 0;
+    if (dc->geometry.label_position == OUTSIDE)
+        dc->geometry.label_length =
+            2 * LABEL_MARGIN +
+            (dc->geometry.orientation != VERTICAL
+                 ? XTextWidth(dc->x.font, LABEL_WIDEST_TEXT,
+                              strlen(LABEL_WIDEST_TEXT))
+                 : dc->x.font->ascent + dc->x.font->descent);
 
-    /* Orientation-related dimensions */
+    /* Orientation-related dimensions, the diameter of a radial gauge fits
+     * in the height of the screen */
     *available_length = dc->geometry.orientation == HORIZONTAL
                             ? WidthOfScreen(dc->x.screen)
                             : HeightOfScreen(dc->x.screen);
+    if (dc->geometry.orientation == RADIAL &&
+        WidthOfScreen(dc->x.screen) < *available_length)
+        *available_length = WidthOfScreen(dc->x.screen);
 
+    /* One column for each sample of the history */
     dc->geometry.length =
-        fit_in(*available_length * conf.length.rel + conf.length.abs, 0,
-               *available_length - 2 * *fat_layer);
+        fit_in(conf.history.samples > 0
+                   ? conf.history.samples * conf.history.column
+                   : *available_length * conf.length.rel + conf.length.abs,
+               0,
+               *available_length - 2 * *fat_layer -
+                   dc->geometry.icon_length - dc->geometry.label_length);
+
+    /* The ring of a radial gauge is at most as thick as its radius */
+    if (dc->geometry.orientation == RADIAL)
+        dc->geometry.thickness =
+            fit_in(dc->geometry.thickness, 1, dc->geometry.length / 2);
 
     /* Compute position of the top-left corner */
     *topleft_x = fit_in(WidthOfScreen(dc->x.screen) * conf.x.rel -
-                            (size_x(dc->geometry) + 2 * *fat_layer) / 2,
+                            window_size_x(dc->geometry) / 2,
                         0,
                         WidthOfScreen(dc->x.screen) -
-                            (size_x(dc->geometry) + 2 * *fat_layer)) +
+                            window_size_x(dc->geometry)) +
                  conf.x.abs;
     *topleft_y = fit_in(HeightOfScreen(dc->x.screen) * conf.y.rel -
-                            (size_y(dc->geometry) + 2 * *fat_layer) / 2,
+                            window_size_y(dc->geometry) / 2,
                         0,
                         HeightOfScreen(dc->x.screen) -
-                            (size_y(dc->geometry) + 2 * *fat_layer)) +
+                            window_size_y(dc->geometry)) +
                  conf.y.abs;
+
+    /* Corners are at most half as large as their layer */
+    dc->geometry.outline_radius =
+        fit_in(dc->geometry.outline_radius, 0,
+               half_side(dc->geometry, 2 * *fat_layer));
+    dc->geometry.border_radius = fit_in(
+        dc->geometry.border_radius, 0,
+        half_side(dc->geometry, 2 * *fat_layer - 2 * dc->geometry.outline));
+    dc->geometry.padding_radius =
+        fit_in(dc->geometry.border_radius - dc->geometry.border, 0,
+               half_side(dc->geometry, 2 * dc->geometry.padding));
+    dc->geometry.content_radius = fit_in(dc->geometry.content_radius, 0,
+                                         half_side(dc->geometry, 0));
 }
 
-/* PUBLIC Returns a new display context from a given configuration. If the
- * .x.display field of the returned display context is NULL, display could not
- * have been opened.*/
-Display_context init(Style conf)
+/* Antialiasing of the corners: samples per pixel along each axis */
+#define CORNER_SAMPLES 4
+
+/* Coverage of a pixel by a rectangle with rounded corners */
+static unsigned char rounded_coverage(int px, int py, int x, int y, int w,
+                                      int h, int r)
 {
-    Display_context dc;
-    Depth dc_depth;
-    Window root;
-    int topleft_x;
-    int topleft_y;
-    int fat_layer;
-    int available_length;
+    int inside = 0;
+
+    /* Only the corners need sampling */
+    if (px < x || px >= x + w || py < y || py >= y + h)
+        return 0;
+    if ((px >= x + r && px < x + w - r) || (py >= y + r && py < y + h - r))
+        return 255;
+
+    for (int i = 0; i < CORNER_SAMPLES; i++)
+    {
+        for (int j = 0; j < CORNER_SAMPLES; j++)
+        {
+            double sx = px + (i + 0.5) / CORNER_SAMPLES;
+            double sy = py + (j + 0.5) / CORNER_SAMPLES;
+            /* Distance to the center of the nearest corner */
+            double dx = sx < x + r ? x + r - sx
+                        : sx > x + w - r ? sx - (x + w - r)
+                                         : 0;
+            double dy = sy < y + r ? y + r - sy
+                        : sy > y + h - r ? sy - (y + h - r)
+                                         : 0;
+
+            if (sx >= x && sx < x + w && sy >= y && sy < y + h &&
+                dx * dx + dy * dy <= (double)r * r)
+                inside++;
+        }
+    }
+
+    return inside * 255 / (CORNER_SAMPLES * CORNER_SAMPLES);
+}
+
+/* Compute the coverage of the shape of each layer over the bar once. Each
+ * layer stays inside the previous one. */
+static void compute_masks(Display_context *dc)
+{
+    Geometry_context g = dc->geometry;
+    int fat_layer = g.outline + g.border + g.padding;
+    int width = 2 * fat_layer + size_x(g);
+    int height = 2 * fat_layer + size_y(g);
+    int inset[MASKS_COUNT] = {0, g.outline, g.outline + g.border, fat_layer};
+    int radius[MASKS_COUNT] = {g.outline_radius, g.border_radius,
+                               g.padding_radius, g.content_radius};
+
+    dc->masks_count = 0;
+    if (!is_rounded(g))
+        return;
+
+    for (int l = 0; l < MASKS_COUNT; l++)
+    {
+        dc->masks[l].width = width;
+        dc->masks[l].height = height;
+        dc->masks[l].alpha = malloc(width * height);
+        if (dc->masks[l].alpha == NULL)
+        {
+            fprintf(stderr, "Error: could not allocate the masks of the "
+                            "rounded corners.\n");
+            free_masks(dc);
+            return;
+        }
+        dc->masks_count++;
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                unsigned char coverage = rounded_coverage(
+                    x, y, inset[l], inset[l], width - 2 * inset[l],
+                    height - 2 * inset[l], radius[l]);
+                if (l > 0 && dc->masks[l - 1].alpha[y * width + x] < coverage)
+                    coverage = dc->masks[l - 1].alpha[y * width + x];
+                dc->masks[l].alpha[y * width + x] = coverage;
+            }
+        }
+    }
+}
+
+/* Tessellate the ring of a radial gauge once into a strip of triangles, in
+ * window coordinates */
+static void compute_gauge(Display_context *dc)
+{
+    Geometry_context g = dc->geometry;
+    int fat_layer = g.outline + g.border + g.padding;
+    double center;
+    double outer;
+    double inner;
+
+    dc->gauge = (Gauge){.x = fat_layer,
+                        .y = fat_layer,
+                        .size = g.length,
+                        .thickness = g.thickness,
+                        .strip = NULL};
+    if (g.orientation != RADIAL)
+        return;
+
+    dc->gauge.strip = malloc(2 * (GAUGE_SEGMENTS + 1) * sizeof(Fixed_point));
+    if (dc->gauge.strip == NULL)
+    {
+        fprintf(stderr, "Error: could not allocate the radial gauge.\n");
+        return;
+    }
+
+    center = fat_layer + g.length / 2.0;
+    outer = g.length / 2.0;
+    inner = outer - g.thickness;
+    for (int i = 0; i <= GAUGE_SEGMENTS; i++)
+    {
+        double angle = (GAUGE_START_ANGLE +
+                        (double)GAUGE_SWEEP_ANGLE * i / GAUGE_SEGMENTS) /
+                       64 * PI / 180;
+
+        /* The y axis goes down */
+        dc->gauge.strip[2 * i] =
+            (Fixed_point){.x = lround((center + outer * cos(angle)) * 65536),
+                          .y = lround((center - outer * sin(angle)) * 65536)};
+        dc->gauge.strip[2 * i + 1] =
+            (Fixed_point){.x = lround((center + inner * cos(angle)) * 65536),
+                          .y = lround((center - inner * sin(angle)) * 65536)};
+    }
+}
+
+/* Rectangles of the segments of a segmented bar, evenly spread along its
+ * length with gaps between them */
+static void compute_segments(Display_context *dc, Segments_style style)
+{
+    Geometry_context g = dc->geometry;
+    Paint none = {.gradient = NO_GRADIENT};
+
+    dc->segments = (Segments){
+        .count = 0, .square_first = 0, .square_last = 0, .rectangles = NULL};
+    if (style.count == 0)
+        return;
+
+    if (g.length + style.gap < style.count * (style.gap + 1))
+    {
+        fprintf(stderr, "Warning: %d segments do not fit in the bar.\n",
+                style.count);
+        return;
+    }
+
+    dc->segments.rectangles = malloc(style.count * sizeof(XRectangle));
+    if (dc->segments.rectangles == NULL)
+    {
+        fprintf(stderr, "Error: could not allocate the segments.\n");
+        return;
+    }
+
+    dc->segments.count = style.count;
+    dc->segments.square_first = style.count;
+    for (int i = 0; i < style.count; i++)
+    {
+        int start = (long)i * (g.length + style.gap) / style.count;
+        int end =
+            (long)(i + 1) * (g.length + style.gap) / style.count - style.gap;
+        Primitive p = segment(g, start, end, none);
+
+        dc->segments.rectangles[i] =
+            (XRectangle){.x = p.x, .y = p.y, .width = p.w, .height = p.h};
+        if (!is_rounded(g) || !touches_inner_corner(g, p))
+        {
+            if (dc->segments.square_first == style.count)
+                dc->segments.square_first = i;
+            dc->segments.square_last = i + 1;
+        }
+    }
+}
+
+/* Load the icon at a given path unless it has already been loaded, returns
+ * its index or NO_ICON */
+static int add_icon(Display_context *dc, const char *paths[], const char *path)
+{
+    int index = NO_ICON;
+
+    if (path[0] == '\0')
+        return NO_ICON;
+
+    for (int i = 0; i < dc->icons_count && index == NO_ICON; i++)
+    {
+        if (strcmp(paths[i], path) == 0)
+            index = i;
+    }
+    if (index == NO_ICON)
+    {
+        dc->icons[dc->icons_count] = load_image(path);
+        if (dc->icons[dc->icons_count].pixels != NULL)
+        {
+            paths[dc->icons_count] = path;
+            index = dc->icons_count++;
+        }
+    }
+
+    return index;
+}
+
+/* Register a gradient between two points of the window, returns its index */
+static int add_gradient(Display_context *dc, Color start, Color end, int x1,
+                        int y1, int x2, int y2)
+{
+    dc->gradients[dc->gradients_count] = (Gradient){
+        .start = start, .end = end, .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2};
+    return dc->gradients_count++;
+}
+
+/* Resolve the colors of a color set into paints. Foreground gradients span
+ * the inside of the bar and background gradients span the whole window, both
+ * in the direction in which the bar fills up (from left to right for a radial
+ * gauge). In history mode, both span the
+ * inside of the bar in the direction in which the columns fill up so that
+ * columns can be moved. */
+static Paints paints_from_colors(Display_context *dc, Colors colors)
+{
+    Geometry_context g = dc->geometry;
+    int fat_layer = g.outline + g.border + g.padding;
+    Paints paints = {.fg = {.color = colors.fg, .gradient = NO_GRADIENT},
+                     .bg = {.color = colors.bg, .gradient = NO_GRADIENT},
+                     .border = {.color = colors.border,
+                                .gradient = NO_GRADIENT},
+                     .label = colors.label,
+                     .icon = NO_ICON};
+
+    if (dc->history.size > 0)
+    {
+        if (colors.fg_gradient)
+            paints.fg.gradient =
+                g.orientation == HORIZONTAL
+                    ? add_gradient(dc, colors.fg, colors.fg_end, 0,
+                                   fat_layer + g.thickness, 0, fat_layer)
+                    : add_gradient(dc, colors.fg, colors.fg_end, fat_layer, 0,
+                                   fat_layer + g.thickness, 0);
+        if (colors.bg_gradient)
+            paints.bg.gradient =
+                g.orientation == HORIZONTAL
+                    ? add_gradient(dc, colors.bg, colors.bg_end, 0,
+                                   fat_layer + g.thickness, 0, fat_layer)
+                    : add_gradient(dc, colors.bg, colors.bg_end, fat_layer, 0,
+                                   fat_layer + g.thickness, 0);
+        return paints;
+    }
+
+    if (colors.fg_gradient)
+        paints.fg.gradient =
+            g.orientation != VERTICAL
+                ? add_gradient(dc, colors.fg, colors.fg_end, fat_layer, 0,
+                               fat_layer + g.length, 0)
+                : add_gradient(dc, colors.fg, colors.fg_end, 0,
+                               fat_layer + g.length, 0, fat_layer);
+    if (colors.bg_gradient)
+        paints.bg.gradient =
+            g.orientation != VERTICAL
+                ? add_gradient(dc, colors.bg, colors.bg_end, 0, 0,
+                               size_x(g) + 2 * fat_layer, 0)
+                : add_gradient(dc, colors.bg, colors.bg_end, 0,
+                               size_y(g) + 2 * fat_layer, 0, 0);
+
+    return paints;
+}
+
+/* Free the client-side images, returns the size of the icons */
+static size_t free_images(Display_context *dc)
+{
+    size_t icons_size = 0;
+
+    free_masks(dc);
+    for (int i = 0; i < dc->icons_count; i++)
+    {
+        icons_size += image_size(dc->icons[i]);
+        image_free(dc->icons[i]);
+        dc->icons[i].pixels = NULL;
+    }
+    return icons_size;
+}
+
+/* Size of the shapes and icons uploaded by the backend */
+static size_t images_size(Display_context dc)
+{
+    size_t size = 0;
+
+    for (int i = 0; i < dc.masks_count; i++)
+        size += (size_t)dc.masks[i].width * dc.masks[i].height;
+    for (int i = 0; i < dc.icons_count; i++)
+        size += image_size(dc.icons[i]);
+    return size;
+}
+
+/* Send the requests buffered by Xlib, if there is a display */
+static void flush(X_context xc)
+{
+    if (xc.display != NULL)
+        XFlush(xc.display);
+}
+
+/* Create an override-redirect window of a given depth on the display */
+static Window create_x_window(X_context xc, Depth depth, Colormap colormap,
+                              unsigned int width, unsigned int height)
+{
+    Window root = RootWindow(xc.display, xc.screen_number);
     XSetWindowAttributes window_attributes;
     static long window_attributes_flags =
         CWColormap | CWBorderPixel | CWOverrideRedirect;
+    Window window;
+
+    window_attributes.colormap = colormap;
+    window_attributes.border_pixel = 0;
+    window_attributes.override_redirect = True;
 
-    dc.x.display = XOpenDisplay(NULL);
+    window = XCreateWindow(xc.display, root, xc.window_x, xc.window_y, width,
+                           height, 0, depth.depth, InputOutput, depth.visuals,
+                           window_attributes_flags, &window_attributes);
+
+    /* Set a WM_CLASS for the window */
+    XClassHint *class_hint = XAllocClassHint();
+    if (class_hint != NULL)
+    {
+        class_hint->res_name = DEFAULT_CONFIG_APPNAME;
+        class_hint->res_class = DEFAULT_CONFIG_APPNAME;
+        XSetClassHint(xc.display, window, class_hint);
+        XFree(class_hint);
+    }
+
+    return window;
+}
+
+/* Create the window and the resources of the backend */
+static Display_context create_window(Display_context dc)
+{
+    Display_context newdc = dc;
+    Depth dc_depth = dc.x.renderer->get_depth(dc);
+
+    newdc.x.depth = dc_depth.depth;
+    newdc.x.colormap = None;
+    newdc.x.window = HEADLESS_WINDOW;
     if (dc.x.display != NULL)
     {
-        dc.x.screen_number = DefaultScreen(dc.x.display);
-        dc.x.screen = ScreenOfDisplay(dc.x.display, dc.x.screen_number);
-        root = RootWindow(dc.x.display, dc.x.screen_number);
+        newdc.x.colormap = XCreateColormap(
+            dc.x.display, RootWindow(dc.x.display, dc.x.screen_number),
+            dc_depth.visuals, AllocNone);
+        newdc.x.window = create_x_window(dc.x, dc_depth, newdc.x.colormap,
+                                         window_size_x(dc.geometry),
+                                         window_size_y(dc.geometry));
+    }
+
+    /* The new window is not mapped yet */
+    newdc.x.shared_window = False;
+    newdc.x.mapped = False;
+    newdc.display_list.presented = False;
+
+    /* Server-side resources */
+    newdc.x.backend = newdc.x.renderer->init(newdc);
+
+    /* Pixels of the window (once redirected by a compositor) and of the
+     * shapes and icons uploaded by the backend */
+    newdc.x.server_size =
+        (size_t)window_size_x(dc.geometry) * window_size_y(dc.geometry) * 4 +
+        images_size(dc);
+
+    return newdc;
+}
+
+/* Whether a context can draw in the window of another one */
+static Bool same_window(Display_context dc, Display_context sibling)
+{
+    return sibling.x.window != None && !sibling.releasable &&
+           !dc.releasable && sibling.x.window_x == dc.x.window_x &&
+           sibling.x.window_y == dc.x.window_y &&
+           window_size_x(sibling.geometry) == window_size_x(dc.geometry) &&
+           window_size_y(sibling.geometry) == window_size_y(dc.geometry) &&
+           sibling.geometry.outline_radius == dc.geometry.outline_radius;
+}
+
+/* Create the resources of the backend for the window of another context */
+static Display_context share_window(Display_context dc,
+                                    Display_context sibling)
+{
+    Display_context newdc = dc;
+
+    newdc.x.window = sibling.x.window;
+    newdc.x.colormap = sibling.x.colormap;
+    newdc.x.depth = sibling.x.depth;
+    newdc.x.shared_window = True;
+    newdc.x.mapped = False;
+    newdc.display_list.presented = False;
+    newdc.x.backend = newdc.x.renderer->init(newdc);
+    newdc.x.server_size = images_size(dc);
 
-        dc_depth = get_display_context_depth(dc);
+    return newdc;
+}
 
-        window_attributes.colormap =
-            XCreateColormap(dc.x.display, root, dc_depth.visuals, AllocNone);
-        window_attributes.border_pixel = 0;
-        window_attributes.override_redirect = True;
+/* Initialize a context on a display drawn by a renderer, which is NULL if
+ * the display could not be opened, drawing in the window of a sibling
+ * context if it is not NULL and has the same geometry */
+static Display_context init_on(Style conf, Display *display,
+                               const Renderer *renderer,
+                               const Display_context *sibling)
+{
+    Display_context dc;
+    int fat_layer;
+    int available_length;
 
-        compute_geometry(conf, &dc, &topleft_x, &topleft_y, &fat_layer,
-                         &available_length);
+    dc.x.display = display;
+    dc.x.renderer = renderer;
+    dc.sibling = sibling != NULL;
+    if (dc.x.renderer != NULL)
+    {
+        dc.x.screen_number = 0;
+        dc.x.screen = &headless_screen;
+        if (dc.x.display != NULL)
+        {
+            dc.x.screen_number = DefaultScreen(dc.x.display);
+            dc.x.screen = ScreenOfDisplay(dc.x.display, dc.x.screen_number);
+        }
+        dc.x.window = None;
+        dc.x.shared_window = False;
+        dc.x.backend = NULL;
+        dc.x.mapped = False;
+        dc.x.server_size = 0;
+        dc.releasable = conf.release > 0;
+        dc.recreatable = dc.releasable || renderer->follows_compositor;
+        dc.stale = False;
+
+        /* Font of the label */
+        dc.x.font = NULL;
+        if (conf.label.position != NO_LABEL && dc.x.display != NULL)
+        {
+            dc.x.font = XLoadQueryFont(dc.x.display, conf.label.font);
+            if (dc.x.font == NULL)
+                fprintf(stderr, "Error: could not load font %s.\n",
+                        conf.label.font);
+        }
 
-        /* Creation of the window */
-        dc.x.window = XCreateWindow(
-            dc.x.display, root, topleft_x, topleft_y,
-            size_x(dc.geometry) + 2 * fat_layer,
-            size_y(dc.geometry) + 2 * fat_layer, 0, dc_depth.depth, InputOutput,
-            dc_depth.visuals, window_attributes_flags, &window_attributes);
+        /* Icons are decoded once */
+        const char *icon_paths[ICONS_MAX];
+        int icon_normal;
+        int icon_overflow;
+        int icon_alt;
+        int icon_altoverflow;
+        dc.icons_count = 0;
+        icon_normal = add_icon(&dc, icon_paths, conf.iconset.normal);
+        icon_overflow = add_icon(&dc, icon_paths, conf.iconset.overflow);
+        icon_alt = add_icon(&dc, icon_paths, conf.iconset.alt);
+        icon_altoverflow = add_icon(&dc, icon_paths, conf.iconset.altoverflow);
 
-        /* Set a WM_CLASS for the window */
-        XClassHint *class_hint = XAllocClassHint();
-        if (class_hint != NULL)
+        /* The inside of a radial gauge is not made of columns */
+        if (conf.orientation == RADIAL && conf.history.samples > 0)
         {
-            class_hint->res_name = DEFAULT_CONFIG_APPNAME;
-            class_hint->res_class = DEFAULT_CONFIG_APPNAME;
-            XSetClassHint(dc.x.display, dc.x.window, class_hint);
-            XFree(class_hint);
+            fprintf(stderr, "Warning: no history for a radial gauge.\n");
+            conf.history.samples = 0;
+        }
+        if ((conf.orientation == RADIAL || conf.history.samples > 0) &&
+            conf.segments.count > 0)
+        {
+            fprintf(stderr, "Warning: no segments for a radial gauge or a "
+                            "history.\n");
+            conf.segments.count = 0;
         }
 
-        /* The new window is not mapped yet */
-        dc.x.mapped = False;
+        compute_geometry(conf, &dc, &dc.x.window_x, &dc.x.window_y,
+                         &fat_layer, &available_length);
+
+        /* The samples of the history are kept in a ring of fixed size */
+        dc.history = (History){.size = 0,
+                               .column = conf.history.column,
+                               .head = 0,
+                               .count = 0,
+                               .samples = NULL};
+        if (conf.history.samples > 0)
+        {
+            dc.history.samples =
+                malloc(conf.history.samples * sizeof(Sample));
+            if (dc.history.samples != NULL)
+                dc.history.size = conf.history.samples;
+            else
+                fprintf(stderr, "Error: could not allocate the history.\n");
+        }
 
         /* Colorscheme */
-        dc.colorscheme = conf.colorscheme;
+        dc.gradients_count = 0;
+        dc.paintscheme.normal =
+            paints_from_colors(&dc, conf.colorscheme.normal);
+        dc.paintscheme.overflow =
+            paints_from_colors(&dc, conf.colorscheme.overflow);
+        dc.paintscheme.alt = paints_from_colors(&dc, conf.colorscheme.alt);
+        dc.paintscheme.altoverflow =
+            paints_from_colors(&dc, conf.colorscheme.altoverflow);
+        dc.paintscheme.normal.icon = icon_normal;
+        dc.paintscheme.overflow.icon = icon_overflow;
+        dc.paintscheme.alt.icon = icon_alt;
+        dc.paintscheme.altoverflow.icon = icon_altoverflow;
+
+        /* Shapes of the rounded corners, of the ring of a radial gauge and
+         * of the segments */
+        compute_masks(&dc);
+        compute_gauge(&dc);
+        compute_segments(&dc, conf.segments);
+
+        /* The window is otherwise created along with the first bar */
+        if (!dc.releasable)
+        {
+            if (sibling != NULL && same_window(dc, *sibling))
+                dc = share_window(dc, *sibling);
+            else
+                dc = create_window(dc);
+
+            /* Images only live on the X server from now on */
+            if (!dc.recreatable)
+            {
+                size_t icons_size = free_images(&dc);
+                if (dc.icons_count > 0)
+                    fprintf(stderr,
+                            "Info: %d icon(s) cached on the X server (%zu "
+                            "bytes).\n",
+                            dc.icons_count, icons_size);
+            }
+        }
     }
 
     return dc;
 }
 
+/* PUBLIC Returns a new display context from a given configuration. If the
+ * .x.display field of the returned display context is NULL, display could not
+ * have been opened.*/
+Display_context init(Style conf, const char *display_name,
+                     const Renderer *renderer)
+{
+    Display *display = NULL;
+
+    if (renderer == NULL || renderer->needs_display)
+    {
+        display = XOpenDisplay(display_name);
+        if (display == NULL)
+            return init_on(conf, NULL, NULL, NULL);
+    }
+
+    if (renderer != NULL && display != NULL && !renderer->supports(display))
+    {
+        fprintf(stderr, "Warning: the %s backend is not supported by the "
+                        "display.\n",
+                renderer->name);
+        renderer = NULL;
+    }
+
+    /* The first renderer the display supports */
+    for (size_t i = 0; renderer == NULL && i < RENDERERS_COUNT; i++)
+        if (renderers[i]->needs_display && renderers[i]->supports(display))
+            renderer = renderers[i];
+
+    fprintf(stderr, "Info: drawing with the %s backend.\n", renderer->name);
+    return init_on(conf, display, renderer, NULL);
+}
+
+/* PUBLIC */
+const Renderer *find_renderer(const char *name)
+{
+    for (size_t i = 0; i < RENDERERS_COUNT; i++)
+        if (strcmp(renderers[i]->name, name) == 0)
+            return renderers[i];
+    return NULL;
+}
+
+/* PUBLIC Initialize a context sharing the display of another one, and its
+ * window if they have the same geometry. It must be destroyed before. */
+Display_context init_sibling(Style conf, Display_context sibling)
+{
+    return init_on(conf, sibling.x.display, sibling.x.renderer, &sibling);
+}
+
 /* PUBLIC Cleans the X memory buffers. */
 void display_context_destroy(Display_context dc)
 {
-    XCloseDisplay(dc.x.display);
+    dc = release_window(dc);
+    if (dc.recreatable)
+        free_images(&dc);
+    free(dc.history.samples);
+    free(dc.gauge.strip);
+    free(dc.segments.rectangles);
+    if (dc.x.font != NULL)
+        XFreeFont(dc.x.display, dc.x.font);
+    if (!dc.sibling && dc.x.display != NULL)
+        XCloseDisplay(dc.x.display);
 }
 
-/* PUBLIC Show a bar filled at value/cap in normal or alternative mode */
+/* PUBLIC Show a bar filled at value/cap in normal or alternative mode. Only
+ * the primitives that changed since the last call are submitted: nothing is
+ * sent to the X server when the bar is already showing the same thing. */
 Display_context show(Display_context dc, int value, int cap,
                      Overflow_mode overflow_mode, Show_mode show_mode)
 {
     Display_context newdc = dc;
 
-    Colors colors;
-    Colors colors_overflow_proportional;
+    Paints colors;
+    Paints colors_overflow_proportional;
 
-    if (!dc.x.mapped)
+    if (dc.x.window == None)
+    {
+        dc = create_window(dc);
+        newdc = dc;
+    }
+
+    if (!dc.x.mapped && dc.x.display != NULL)
     {
         XMapWindow(dc.x.display, dc.x.window);
         XRaiseWindow(dc.x.display, dc.x.window);
+    }
+    if (!dc.x.mapped)
+    {
         newdc.x.mapped = True;
+        /* The content of an unmapped window is lost */
+        dc.display_list.presented = False;
     }
 
     switch (show_mode)
     {
     case NORMAL:
-        colors_overflow_proportional = dc.colorscheme.normal;
+        colors_overflow_proportional = dc.paintscheme.normal;
         if (value <= cap)
-            colors = dc.colorscheme.normal;
+            colors = dc.paintscheme.normal;
         else
-            colors = dc.colorscheme.overflow;
+            colors = dc.paintscheme.overflow;
         break;
 
     case ALTERNATIVE:
-        colors_overflow_proportional = dc.colorscheme.alt;
+        colors_overflow_proportional = dc.paintscheme.alt;
         if (value <= cap)
-            colors = dc.colorscheme.alt;
+            colors = dc.paintscheme.alt;
         else
-            colors = dc.colorscheme.altoverflow;
+            colors = dc.paintscheme.altoverflow;
         break;
     }
 
     /* Empty bar */
-    draw_empty(dc.x, dc.geometry, colors);
-
-    /* Content */
-    draw_content(dc.x, dc.geometry,
-                 fit_in(value, 0, cap) * dc.geometry.length / cap, colors.fg);
+    draw_empty(&newdc.display_list, dc.geometry, colors);
 
+    /* History: a new sample, drawn in a column of its own */
+    if (dc.history.size > 0)
+    {
+        newdc.history.samples[dc.history.head] = (Sample){
+            .filled = fit_in((long)fit_in(value, 0, cap) *
+                                 dc.geometry.thickness / cap,
+                             0, dc.geometry.thickness),
+            .paint = colors.fg};
+        newdc.history.head = (dc.history.head + 1) % dc.history.size;
+        newdc.history.count = fit_in(dc.history.count + 1, 0, dc.history.size);
+        draw_no_content(&newdc.display_list);
+    }
+    /* Segments: lit as the value grows, the overflow being shown by the
+     * colors only */
+    else if (dc.segments.count > 0)
+    {
+        draw_segments(&newdc.display_list, dc.geometry,
+                      (long)fit_in(value, 0, cap) * dc.segments.count / cap,
+                      colors);
+    }
     /* Proportional overflow : draw separator */
-    if (value > cap && overflow_mode == PROPORTIONAL &&
-        cap * dc.geometry.length / value > dc.geometry.padding)
+    else if (value > cap && overflow_mode == PROPORTIONAL &&
+             cap * dc.geometry.length / value > dc.geometry.padding)
     {
-        draw_content(dc.x, dc.geometry, cap * dc.geometry.length / value,
-                     colors_overflow_proportional.fg);
-        draw_separator(dc.x, dc.geometry, cap * dc.geometry.length / value,
-                       colors.bg);
+        draw_separator(&newdc.display_list, dc.geometry,
+                       cap * dc.geometry.length / value,
+                       colors_overflow_proportional.fg, colors.bg, colors.fg);
+    }
+    /* Content */
+    else
+    {
+        draw_content(&newdc.display_list, dc.geometry,
+                     fit_in(value, 0, cap) * dc.geometry.length / cap, colors);
     }
 
-    XFlush(dc.x.display);
+    /* Label and icon */
+    draw_label(&newdc.display_list, dc.geometry, dc.x.font,
+               (long)value * 100 / cap, colors);
+    draw_icon_area(&newdc.display_list, dc.geometry, dc.icons, colors);
+
+    if (present(dc.x, dc.geometry, newdc.history, dc.segments,
+                dc.display_list, &newdc.display_list) > 0 ||
+        !dc.x.mapped)
+        flush(dc.x);
 
     return newdc;
 }
@@ -259,10 +1518,114 @@ Display_context hide(Display_context dc)
 
     if (dc.x.mapped)
     {
-        XUnmapWindow(dc.x.display, dc.x.window);
+        if (dc.x.display != NULL)
+            XUnmapWindow(dc.x.display, dc.x.window);
+        newdc.x.mapped = False;
+        flush(dc.x);
+    }
+
+    return newdc;
+}
+
+/* PUBLIC Draw the bar in every mode into its window without mapping it, so
+ * that the code, the data and the buffers of the render path are in memory
+ * before the first value. Nothing is drawn without a window or while it is
+ * displayed. */
+Display_context warm(Display_context dc, Overflow_mode overflow_mode)
+{
+    static const int values[] = {0, 50, 100, 150};
+    static const Show_mode modes[] = {NORMAL, ALTERNATIVE};
+    Display_context newdc = dc;
+
+    if (dc.x.window == None || dc.x.mapped)
+        return dc;
+
+    /* Drawing in an unmapped window is lost, the next value draws the whole
+     * bar again and the history only gets real samples */
+    newdc.x.mapped = True;
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+        for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); j++)
+            newdc = show(newdc, values[j], 100, overflow_mode, modes[i]);
+    newdc.x.mapped = False;
+    newdc.display_list.presented = False;
+    newdc.history.head = dc.history.head;
+    newdc.history.count = dc.history.count;
+
+    return newdc;
+}
+
+/* PUBLIC Destroy the window and the resources of the backend, they are
+ * created again by the next call to show() */
+Display_context release_window(Display_context dc)
+{
+    Display_context newdc = dc;
+
+    if (dc.x.window != None)
+    {
+        dc.x.renderer->destroy(dc.x);
+        if (!dc.x.shared_window && dc.x.display != NULL)
+        {
+            XDestroyWindow(dc.x.display, dc.x.window);
+            XFreeColormap(dc.x.display, dc.x.colormap);
+        }
+        newdc.x.backend = NULL;
+        newdc.x.window = None;
         newdc.x.mapped = False;
-        XFlush(dc.x.display);
+        newdc.x.server_size = 0;
+        newdc.display_list.presented = False;
+        newdc.stale = False;
+        flush(dc.x);
     }
 
     return newdc;
 }
+
+/* PUBLIC Follow an X event. When a new window would have another depth, the
+ * context becomes stale until refresh_windows() creates its window again. It
+ * is not released at once: another style may be displaying it. */
+Display_context handle_event(Display_context dc, XEvent *event)
+{
+    Display_context newdc = dc;
+
+    if (dc.x.renderer->event(dc.x, event) && dc.recreatable)
+        newdc.stale = True;
+
+    return newdc;
+}
+
+/* PUBLIC Create again the windows of the stale contexts that are not
+ * displayed, at the depth a new window has now. A context drawing in the
+ * window of another one follows it in the array: they are released from the
+ * last one, so that no backend resource outlives the window, then share the
+ * new window. A window only created when needed is left to the next bar. */
+void refresh_windows(Display_context dcs[], int count)
+{
+    int first = 0;
+
+    while (first < count)
+    {
+        int last = first + 1;
+        Bool stale = dcs[first].stale;
+        Bool mapped = dcs[first].x.mapped;
+
+        while (last < count && dcs[last].x.shared_window)
+        {
+            stale = stale || dcs[last].stale;
+            mapped = mapped || dcs[last].x.mapped;
+            last++;
+        }
+
+        if (stale && !mapped)
+        {
+            for (int i = last - 1; i >= first; i--)
+                dcs[i] = release_window(dcs[i]);
+            if (!dcs[first].releasable)
+            {
+                dcs[first] = create_window(dcs[first]);
+                for (int i = first + 1; i < last; i++)
+                    dcs[i] = share_window(dcs[i], dcs[first]);
+            }
+        }
+        first = last;
+    }
+}
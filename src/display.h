@@ -19,6 +19,7 @@
 #define DISPLAY_H
 
 #include "conf.h"
+#include "image.h"
 #include <X11/Xlib.h>
 
 typedef enum
@@ -27,13 +28,33 @@ typedef enum
     ALTERNATIVE
 } Show_mode;
 
+/* Resources kept by the rendering backend, see display_xlib.c,
+ * display_xrender.c and display_null.c */
+typedef struct Backend_context Backend_context;
+
+/* The functions of a rendering backend, chosen when a display is opened */
+typedef struct Renderer Renderer;
+
 typedef struct
 {
+    /* NULL for a renderer that needs no display */
     Display *display;
     int screen_number;
     Screen *screen;
+    /* None while the window is released */
     Window window;
+    Colormap colormap;
+    int depth;
+    /* The window belongs to another context */
+    Bool shared_window;
+    int window_x;
+    int window_y;
     Bool mapped;
+    /* Estimated size of the window and its resources on the X server */
+    size_t server_size;
+    XFontStruct *font;
+    const Renderer *renderer;
+    Backend_context *backend;
 } X_context;
 
 typedef struct
@@ -44,25 +65,323 @@ typedef struct
     int length;
     int thickness;
     Orientation orientation;
+    /* Corner radii of the outer edges of the outline, border and padding
+     * layers and of the inside of the bar */
+    int outline_radius;
+    int border_radius;
+    int padding_radius;
+    int content_radius;
+    Label_position label_position;
+    /* Room taken by the icons then by an outside label past the right
+     * (horizontal) or bottom (vertical) edge of the bar */
+    int icon_length;
+    int label_length;
 } Geometry_context;
 
+/* A linear gradient between two points given in window coordinates */
+typedef struct
+{
+    Color start;
+    Color end;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} Gradient;
+
+/* One for the foreground and one for the background of each color set */
+#define GRADIENTS_MAX 8
+
+/* A plain color or, when gradient is not NO_GRADIENT, the index of a gradient
+ * in the display context (the color is then unused) */
+#define NO_GRADIENT -1
+
+typedef struct
+{
+    Color color;
+    int gradient;
+} Paint;
+
+/* One for each color set, the index of an icon in the display context or
+ * NO_ICON */
+#define ICONS_MAX 4
+#define NO_ICON -1
+
+typedef struct
+{
+    Paint fg;
+    Paint bg;
+    Paint border;
+    Color label;
+    int icon;
+} Paints;
+
+typedef struct
+{
+    Paints normal;
+    Paints overflow;
+    Paints alt;
+    Paints altoverflow;
+} Paintscheme;
+
+/* Coverage (from 0 to 255) of the rounded shape of a layer of the bar over
+ * the whole window */
+typedef struct
+{
+    int width;
+    int height;
+    unsigned char *alpha;
+} Coverage;
+
+/* Layers of a bar with rounded corners, from the outermost one. Primitives
+ * of a bar without rounded corners have NO_MASK. */
+#define OUTLINE_MASK 0
+#define BORDER_MASK 1
+#define PADDING_MASK 2
+#define CONTENT_MASK 3
+#define MASKS_COUNT 4
+#define NO_MASK -1
+
+/* A filled rectangle as produced by the drawing functions. When arc_first <
+ * arc_last, the segments [arc_first, arc_last[ of the ring of a radial gauge
+ * are filled instead and the rectangle is the bounding box of the ring. */
+typedef struct
+{
+    int x;
+    int y;
+    unsigned int w;
+    unsigned int h;
+    Paint paint;
+    int mask;
+    int arc_first;
+    int arc_last;
+} Primitive;
+
+/* The characters a label is made of, their glyphs are loaded once */
+#define LABEL_CHARSET "0123456789%-"
+#define LABEL_TEXT_SIZE 16
+
+/* A text drawn from the given baseline origin, within the given box */
+typedef struct
+{
+    int x;
+    int y;
+    int length;
+    char text[LABEL_TEXT_SIZE];
+    Color color;
+    int box_x;
+    int box_y;
+    unsigned int box_w;
+    unsigned int box_h;
+} Label;
+
+/* An icon of the display context drawn from its top-left corner */
+typedef struct
+{
+    int index;
+    int x;
+    int y;
+} Icon;
+
+/* The frame layers are nested (each one is painted over the previous one)
+ * whereas the content slots form a partition of the inside of the bar. The
+ * last slots are the backgrounds of an outside label and of the icon. */
+#define DISPLAY_LIST_FRAME_SIZE 3
+#define DISPLAY_LIST_CONTENT_SIZE 4
+#define DISPLAY_LIST_LABEL_SIZE 1
+#define DISPLAY_LIST_ICON_SIZE 1
+#define DISPLAY_LIST_SIZE                                                      \
+    (DISPLAY_LIST_FRAME_SIZE + DISPLAY_LIST_CONTENT_SIZE +                     \
+     DISPLAY_LIST_LABEL_SIZE + DISPLAY_LIST_ICON_SIZE)
+
+/* A sample of the history: filled length across the bar and its paint */
+typedef struct
+{
+    int filled;
+    Paint paint;
+} Sample;
+
+/* The last samples in a fixed-size ring, the newest one being drawn at the
+ * end of the bar (right of a horizontal bar, top of a vertical bar) in a
+ * column of its own. Disabled if its size is 0. */
+typedef struct
+{
+    int size;
+    int column;
+    int head;
+    int count;
+    Sample *samples;
+} History;
+
+/* The arc of a radial gauge, in 64ths of degree counterclockwise from 3
+ * o'clock as for Xlib arcs: from the bottom left clockwise over the top to
+ * the bottom right */
+#define GAUGE_START_ANGLE (225 * 64)
+#define GAUGE_SWEEP_ANGLE (-270 * 64)
+
+/* Segments the ring of a radial gauge is divided into, the filled ones
+ * being proportional to the value */
+#define GAUGE_SEGMENTS 128
+
+/* A point in 1/65536 of pixel */
+typedef struct
+{
+    int x;
+    int y;
+} Fixed_point;
+
+/* The ring of a radial gauge, tessellated once into a strip of triangles
+ * along the arc. Points on its outer and inner edges alternate at the ends
+ * of each segment, so that the segments [first, last[ are covered by the
+ * 2 (last - first + 1) points starting at 2 first. There is no strip for a
+ * bar. */
+typedef struct
+{
+    /* Bounding square of the ring and thickness of the ring */
+    int x;
+    int y;
+    int size;
+    int thickness;
+    Fixed_point *strip;
+} Gauge;
+
+/* The segments of a segmented bar in the order they are lit, computed once
+ * with the geometry. The segments [square_first, square_last[ lie away
+ * from the shaped corners of the inside of the bar and are drawn together,
+ * the other ones (if any) one at a time. Disabled if its count is 0. */
+typedef struct
+{
+    int count;
+    int square_first;
+    int square_last;
+    XRectangle *rectangles;
+} Segments;
+
+typedef struct
+{
+    Primitive primitives[DISPLAY_LIST_SIZE];
+    Label label;
+    Icon icon;
+    /* Lit segments of a segmented bar and their paint, the other ones being
+     * the background of the inside of the bar */
+    int lit;
+    Paint lit_paint;
+    Bool presented;
+} Display_list;
+
 typedef struct
 {
     X_context x;
-    Colorscheme colorscheme;
+    Paintscheme paintscheme;
+    Gradient gradients[GRADIENTS_MAX];
+    int gradients_count;
+    /* Whether the window is only created when needed and may be released */
+    Bool releasable;
+    /* Whether the window may be created again, once released or at another
+     * depth, in which case the pixels are kept */
+    Bool recreatable;
+    /* A new window would have another depth, this one is created again when
+     * it is not displayed */
+    Bool stale;
+    /* The display belongs to another context */
+    Bool sibling;
+    /* The pixels are only kept until they are uploaded by the renderer */
+    Image icons[ICONS_MAX];
+    int icons_count;
+    /* Likewise, there are no masks if no corner is rounded */
+    Coverage masks[MASKS_COUNT];
+    int masks_count;
     Geometry_context geometry;
+    Gauge gauge;
+    Segments segments;
+    History history;
+    Display_list display_list;
 } Display_context;
 
-Display_context init(Style conf);
+/* Initialize a context on a display given by its name, or by the DISPLAY
+ * environment variable if it is NULL, drawn by a renderer or by the best one
+ * the display supports if it is NULL. The renderer of the context is NULL if
+ * the display cannot be opened. */
+Display_context init(Style conf, const char *display_name,
+                     const Renderer *renderer);
+Display_context init_sibling(Style conf, Display_context sibling);
 Display_context show(Display_context dc, int value, int cap,
                      Overflow_mode overflow_mode, Show_mode show_mode);
 Display_context hide(Display_context dc);
+Display_context warm(Display_context dc, Overflow_mode overflow_mode);
+Display_context release_window(Display_context dc);
+Display_context handle_event(Display_context dc, XEvent *event);
+void refresh_windows(Display_context dcs[], int count);
 void display_context_destroy(Display_context dc);
 
-/* Draw a rectangle with the given size, position and color */
-void fill_rectangle(X_context xc, Color c, int x, int y, unsigned int w,
-                    unsigned int h);
+struct Renderer
+{
+    const char *name;
+    /* Renderers that need no display draw nothing, the geometry of the bar
+     * is then computed for a screen of HEADLESS_WIDTH by HEADLESS_HEIGHT */
+    Bool needs_display;
+    /* Whether the depth of a new window follows the compositing manager
+     * while the bar is up */
+    Bool follows_compositor;
+    Bool (*supports)(Display *display);
+
+    Depth (*get_depth)(Display_context dc);
+
+    /* Allocate the backend resources once the window exists (e.g.
+     * server-side gradients) and free them */
+    Backend_context *(*init)(Display_context dc);
+    void (*destroy)(X_context xc);
+
+    /* Draw a rectangle with the given size, position and color */
+    void (*fill_rectangle)(X_context xc, Color c, int x, int y,
+                           unsigned int w, unsigned int h);
+
+    /* Draw a text made of characters of LABEL_CHARSET with the given color
+     * and baseline origin */
+    void (*draw_text)(X_context xc, Color c, int x, int y, const char *text,
+                      int length);
+
+    /* Draw an icon of the display context from its top-left corner */
+    void (*draw_icon)(X_context xc, int icon, int x, int y);
+
+    /* Draw rectangles with the same paint in a single request, replacing
+     * what is under them */
+    void (*fill_rectangles)(X_context xc, Paint paint,
+                            const XRectangle *rectangles, int count);
+
+    /* Draw a layer of a bar with rounded corners within a rectangle with
+     * the given size and position. The layers are drawn from the outermost
+     * one and the coverage of their shapes add up: the first one replaces
+     * what is under the rectangle and the next ones are added to it. */
+    void (*fill_layer)(X_context xc, Paint paint, int mask, Bool replace,
+                       int x, int y, unsigned int w, unsigned int h);
+
+    /* Copy a part of the window to another position of the window */
+    void (*copy_area)(X_context xc, int x, int y, unsigned int w,
+                      unsigned int h, int dest_x, int dest_y);
+
+    /* Draw the part of a gradient of the display context that lies within
+     * a rectangle with the given size and position */
+    void (*fill_gradient)(X_context xc, int gradient, int x, int y,
+                          unsigned int w, unsigned int h);
+
+    /* Fill the segments [first, last[ of the ring of a radial gauge over
+     * what is under them */
+    void (*fill_arc)(X_context xc, Paint paint, int first, int last);
+
+    /* Follow an X event, such as the start of a compositing manager.
+     * Returns true if the depth of a new window would change. */
+    Bool (*event)(X_context xc, XEvent *event);
+};
+
+#define HEADLESS_WIDTH 1920
+#define HEADLESS_HEIGHT 1080
+
+extern const Renderer xrender_renderer;
+extern const Renderer xlib_renderer;
+extern const Renderer null_renderer;
 
-Depth get_display_context_depth(Display_context dc);
+/* A renderer built in by its name, NULL if there is none */
+const Renderer *find_renderer(const char *name);
 
 #endif /* __DISPLAY_H__ */
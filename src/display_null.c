@@ -0,0 +1,201 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* A headless backend: the primitives are counted instead of being drawn, so
+ * that everything but the X server can be measured without a display */
+
+#include "display.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct Backend_context
+{
+    unsigned long rectangles;
+    unsigned long gradients;
+    unsigned long layers;
+    unsigned long copies;
+    unsigned long texts;
+    unsigned long icons;
+    unsigned long arcs;
+    /* Triangles of the arcs */
+    unsigned long triangles;
+    /* Pixels covered by the primitives but the arcs */
+    unsigned long long pixels;
+};
+
+static Bool supports(Display *display)
+{
+    (void)display;
+    return True;
+}
+
+static Depth get_depth(Display_context dc)
+{
+    (void)dc;
+    return (Depth){.depth = 32, .visuals = NULL, .nvisuals = 0};
+}
+
+static Backend_context *backend_init(Display_context dc)
+{
+    Backend_context *bc = calloc(1, sizeof(Backend_context));
+
+    (void)dc;
+    return bc;
+}
+
+static void backend_destroy(X_context xc)
+{
+    Backend_context *bc = xc.backend;
+
+    if (bc != NULL)
+    {
+        fprintf(stderr,
+                "Info: null backend covered %llu pixels with %lu "
+                "rectangles, %lu gradients, %lu layers, %lu copies, %lu "
+                "texts and %lu icons, and drew %lu arcs of %lu "
+                "triangles.\n",
+                bc->pixels, bc->rectangles, bc->gradients, bc->layers,
+                bc->copies, bc->texts, bc->icons, bc->arcs, bc->triangles);
+        free(bc);
+    }
+}
+
+static void fill_rectangle(X_context xc, Color c, int x, int y,
+                           unsigned int w, unsigned int h)
+{
+    (void)c;
+    (void)x;
+    (void)y;
+    if (xc.backend != NULL)
+    {
+        xc.backend->rectangles++;
+        xc.backend->pixels += (unsigned long long)w * h;
+    }
+}
+
+static void fill_rectangles(X_context xc, Paint paint,
+                            const XRectangle *rectangles, int count)
+{
+    (void)paint;
+    if (xc.backend != NULL)
+    {
+        xc.backend->rectangles++;
+        for (int i = 0; i < count; i++)
+            xc.backend->pixels +=
+                (unsigned long long)rectangles[i].width * rectangles[i].height;
+    }
+}
+
+static void draw_text(X_context xc, Color c, int x, int y, const char *text,
+                      int length)
+{
+    (void)c;
+    (void)x;
+    (void)y;
+    (void)text;
+    (void)length;
+    if (xc.backend != NULL)
+        xc.backend->texts++;
+}
+
+static void draw_icon(X_context xc, int icon, int x, int y)
+{
+    (void)icon;
+    (void)x;
+    (void)y;
+    if (xc.backend != NULL)
+        xc.backend->icons++;
+}
+
+static void fill_layer(X_context xc, Paint paint, int mask, Bool replace,
+                       int x, int y, unsigned int w, unsigned int h)
+{
+    (void)paint;
+    (void)mask;
+    (void)replace;
+    (void)x;
+    (void)y;
+    if (xc.backend != NULL)
+    {
+        xc.backend->layers++;
+        xc.backend->pixels += (unsigned long long)w * h;
+    }
+}
+
+static void copy_area(X_context xc, int x, int y, unsigned int w,
+                      unsigned int h, int dest_x, int dest_y)
+{
+    (void)x;
+    (void)y;
+    (void)dest_x;
+    (void)dest_y;
+    if (xc.backend != NULL)
+    {
+        xc.backend->copies++;
+        xc.backend->pixels += (unsigned long long)w * h;
+    }
+}
+
+static void fill_gradient(X_context xc, int gradient, int x, int y,
+                          unsigned int w, unsigned int h)
+{
+    (void)gradient;
+    (void)x;
+    (void)y;
+    if (xc.backend != NULL)
+    {
+        xc.backend->gradients++;
+        xc.backend->pixels += (unsigned long long)w * h;
+    }
+}
+
+static void fill_arc(X_context xc, Paint paint, int first, int last)
+{
+    (void)paint;
+    if (xc.backend != NULL)
+    {
+        xc.backend->arcs++;
+        xc.backend->triangles += 2 * (last - first);
+    }
+}
+
+/* There is no X server to receive events from */
+static Bool backend_event(X_context xc, XEvent *event)
+{
+    (void)xc;
+    (void)event;
+    return False;
+}
+
+const Renderer null_renderer = {
+    .name = "null",
+    .needs_display = False,
+    .follows_compositor = False,
+    .supports = supports,
+    .get_depth = get_depth,
+    .init = backend_init,
+    .destroy = backend_destroy,
+    .fill_rectangle = fill_rectangle,
+    .fill_rectangles = fill_rectangles,
+    .draw_text = draw_text,
+    .draw_icon = draw_icon,
+    .fill_layer = fill_layer,
+    .copy_area = copy_area,
+    .fill_gradient = fill_gradient,
+    .fill_arc = fill_arc,
+    .event = backend_event,
+};
@@ -17,8 +17,20 @@
 
 #include "display.h"
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
-static GC gc_from_color(X_context xc, Color color)
+/* Maximum number of plain color bands approximating a gradient */
+#define GRADIENT_BANDS 16
+
+/* The plain colors of the foreground, background, border and label of each
+ * color set */
+#define PIXELS_MAX 16
+
+static unsigned long pixel_from_color(X_context xc, Color color)
 {
     XColor xcolor = {
         .red = color.red * 257,
@@ -26,24 +38,527 @@ static GC gc_from_color(X_context xc, Color color)
         .blue = color.blue * 257,
         .flags = DoRed | DoGreen | DoBlue,
     };
-    GC gc = XCreateGC(xc.display, xc.window, 0, NULL);
     Colormap colormap = DefaultColormap(xc.display, xc.screen_number);
     XAllocColor(xc.display, colormap, &xcolor);
-    XSetForeground(xc.display, gc, xcolor.pixel);
+    return xcolor.pixel;
+}
+
+/* A gradient approximated by bands of plain color along the x axis
+ * (horizontal gradients) or the y axis. Band i covers [low[i], high[i][ and
+ * the first and last bands extend beyond the ends of the gradient. */
+typedef struct
+{
+    Bool vertical;
+    int count;
+    int low[GRADIENT_BANDS];
+    int high[GRADIENT_BANDS];
+    unsigned long pixels[GRADIENT_BANDS];
+} Banded_gradient;
+
+/* An icon is drawn through a clip mask of its opaque pixels */
+typedef struct
+{
+    Pixmap pixmap;
+    GC gc;
+    unsigned int width;
+    unsigned int height;
+    int clip_x;
+    int clip_y;
+} Xlib_icon;
+
+struct Backend_context
+{
+    GC gc;
+    int masks_count;
+    GC masks[MASKS_COUNT];
+    int icons_count;
+    Xlib_icon icons[ICONS_MAX];
+    Banded_gradient gradients[GRADIENTS_MAX];
+    int pixels_count;
+    Color colors[PIXELS_MAX];
+    unsigned long pixels[PIXELS_MAX];
+    /* Pie slices of a radial gauge are clipped to its ring */
+    Gauge gauge;
+    GC ring;
+};
+
+static unsigned char interpolate(unsigned char a, unsigned char b, double t)
+{
+    return a + (b - a) * t + 0.5;
+}
+
+static Banded_gradient banded_from_gradient(X_context xc, Gradient gradient)
+{
+    Banded_gradient banded;
+    Color band;
+    int from;
+    int to;
+
+    banded.vertical = gradient.x1 == gradient.x2;
+    from = banded.vertical ? gradient.y1 : gradient.x1;
+    to = banded.vertical ? gradient.y2 : gradient.x2;
+    banded.count = abs(to - from);
+    banded.count = banded.count < 1 ? 1 : banded.count;
+    banded.count =
+        banded.count > GRADIENT_BANDS ? GRADIENT_BANDS : banded.count;
+
+    for (int i = 0; i < banded.count; i++)
+    {
+        double t = (i + 0.5) / banded.count;
+        int a = from + (to - from) * i / banded.count;
+        int b = from + (to - from) * (i + 1) / banded.count;
+
+        if (i == 0)
+            a = from < to ? INT_MIN : INT_MAX;
+        if (i == banded.count - 1)
+            b = from < to ? INT_MAX : INT_MIN;
+        banded.low[i] = a < b ? a : b;
+        banded.high[i] = a < b ? b : a;
+
+        band.red = interpolate(gradient.start.red, gradient.end.red, t);
+        band.green = interpolate(gradient.start.green, gradient.end.green, t);
+        band.blue = interpolate(gradient.start.blue, gradient.end.blue, t);
+        banded.pixels[i] = pixel_from_color(xc, band);
+    }
+
+    return banded;
+}
+
+/* Scale an 8 bit channel to the bits of a visual mask */
+static unsigned long channel_to_mask(unsigned int channel, unsigned long mask)
+{
+    int shift = 0;
+
+    while (mask != 0 && (mask & 1) == 0)
+    {
+        mask >>= 1;
+        shift++;
+    }
+    return ((channel * mask + 127) / 255) << shift;
+}
+
+/* Upload an image to a pixmap of the default visual, the alpha channel being
+ * reduced to a clip mask */
+static Xlib_icon icon_from_image(X_context xc, Image image)
+{
+    Visual *visual = DefaultVisual(xc.display, xc.screen_number);
+    int depth = DefaultDepth(xc.display, xc.screen_number);
+    Xlib_icon icon = {.pixmap = None,
+                      .gc = None,
+                      .width = image.width,
+                      .height = image.height,
+                      .clip_x = 0,
+                      .clip_y = 0};
+    XImage *colors = XCreateImage(xc.display, visual, depth, ZPixmap, 0, NULL,
+                                  image.width, image.height, 32, 0);
+    XImage *mask = XCreateImage(xc.display, visual, 1, XYBitmap, 0, NULL,
+                                image.width, image.height, 8, 0);
+
+    if (colors != NULL && mask != NULL)
+    {
+        colors->data = malloc(colors->bytes_per_line * image.height);
+        mask->data = calloc(mask->bytes_per_line * image.height, 1);
+    }
+
+    if (colors != NULL && mask != NULL && colors->data != NULL &&
+        mask->data != NULL)
+    {
+        for (int y = 0; y < image.height; y++)
+        {
+            for (int x = 0; x < image.width; x++)
+            {
+                unsigned int p = image.pixels[y * image.width + x];
+                XPutPixel(colors, x, y,
+                          channel_to_mask((p >> 16) & 0xff, visual->red_mask) |
+                              channel_to_mask((p >> 8) & 0xff,
+                                              visual->green_mask) |
+                              channel_to_mask(p & 0xff, visual->blue_mask));
+                XPutPixel(mask, x, y, (p >> 24) >= 0x80);
+            }
+        }
+
+        icon.pixmap = XCreatePixmap(xc.display, xc.window, image.width,
+                                    image.height, depth);
+        Pixmap clip = XCreatePixmap(xc.display, xc.window, image.width,
+                                    image.height, 1);
+        GC clip_gc = XCreateGC(xc.display, clip, 0, NULL);
+        icon.gc = XCreateGC(xc.display, xc.window, 0, NULL);
+
+        XPutImage(xc.display, icon.pixmap, icon.gc, colors, 0, 0, 0, 0,
+                  image.width, image.height);
+        XPutImage(xc.display, clip, clip_gc, mask, 0, 0, 0, 0, image.width,
+                  image.height);
+        XSetClipMask(xc.display, icon.gc, clip);
+
+        XFreeGC(xc.display, clip_gc);
+        XFreePixmap(xc.display, clip);
+    }
+
+    if (colors != NULL)
+        XDestroyImage(colors);
+    if (mask != NULL)
+        XDestroyImage(mask);
+    return icon;
+}
+
+/* A graphics context that only draws within the shape of a layer, the
+ * coverage being reduced to a clip mask */
+static GC gc_from_coverage(X_context xc, Coverage coverage)
+{
+    Visual *visual = DefaultVisual(xc.display, xc.screen_number);
+    XImage *mask = XCreateImage(xc.display, visual, 1, XYBitmap, 0, NULL,
+                                coverage.width, coverage.height, 8, 0);
+    GC gc = XCreateGC(xc.display, xc.window, 0, NULL);
+
+    if (mask != NULL)
+        mask->data = calloc(mask->bytes_per_line * coverage.height, 1);
+
+    if (mask != NULL && mask->data != NULL)
+    {
+        for (int y = 0; y < coverage.height; y++)
+            for (int x = 0; x < coverage.width; x++)
+                XPutPixel(mask, x, y,
+                          coverage.alpha[y * coverage.width + x] >= 0x80);
+
+        Pixmap clip = XCreatePixmap(xc.display, xc.window, coverage.width,
+                                    coverage.height, 1);
+        GC clip_gc = XCreateGC(xc.display, clip, 0, NULL);
+        XPutImage(xc.display, clip, clip_gc, mask, 0, 0, 0, 0, coverage.width,
+                  coverage.height);
+        XSetClipMask(xc.display, gc, clip);
+        XFreeGC(xc.display, clip_gc);
+        XFreePixmap(xc.display, clip);
+    }
+
+    if (mask != NULL)
+        XDestroyImage(mask);
+    return gc;
+}
+
+/* The ring of a radial gauge as a clip mask: the pixels whose center lies
+ * between its inner and outer circles */
+static GC gc_from_gauge(X_context xc, Gauge gauge)
+{
+    int side = gauge.x + gauge.size;
+    double center = gauge.x + gauge.size / 2.0;
+    double outer = gauge.size / 2.0;
+    double inner = outer - gauge.thickness;
+    Coverage ring = {.width = side,
+                     .height = side,
+                     .alpha = calloc((size_t)side * side, 1)};
+    GC gc;
+
+    if (ring.alpha == NULL)
+        return None;
+
+    for (int y = 0; y < side; y++)
+    {
+        for (int x = 0; x < side; x++)
+        {
+            double r = hypot(x + 0.5 - center, y + 0.5 - center);
+            ring.alpha[y * side + x] = r <= outer && r >= inner ? 0xff : 0;
+        }
+    }
+
+    gc = gc_from_coverage(xc, ring);
+    XSetArcMode(xc.display, gc, ArcPieSlice);
+    free(ring.alpha);
     return gc;
 }
 
-void fill_rectangle(X_context xc, Color color, int x, int y, unsigned int w,
-                    unsigned int h)
+/* Allocate a color unless it already is */
+static void add_pixel(X_context xc, Backend_context *bc, Color color)
+{
+    for (int i = 0; i < bc->pixels_count; i++)
+    {
+        if (memcmp(&bc->colors[i], &color, sizeof(Color)) == 0)
+            return;
+    }
+    if (bc->pixels_count < PIXELS_MAX)
+    {
+        bc->colors[bc->pixels_count] = color;
+        bc->pixels[bc->pixels_count++] = pixel_from_color(xc, color);
+    }
+}
+
+static void add_pixels(X_context xc, Backend_context *bc, Paints paints)
 {
-    GC xgc = gc_from_color(xc, color);
-    XFillRectangle(xc.display, xc.window, xgc, x, y, w, h);
-    XFreeGC(xc.display, xgc);
+    if (paints.fg.gradient == NO_GRADIENT)
+        add_pixel(xc, bc, paints.fg.color);
+    if (paints.bg.gradient == NO_GRADIENT)
+        add_pixel(xc, bc, paints.bg.color);
+    if (paints.border.gradient == NO_GRADIENT)
+        add_pixel(xc, bc, paints.border.color);
+    add_pixel(xc, bc, paints.label);
 }
 
-Depth get_display_context_depth(Display_context dc)
+/* Colors are all allocated beforehand, which takes a round trip to the X
+ * server for each one */
+static unsigned long find_pixel(X_context xc, Color color)
+{
+    for (int i = 0; i < xc.backend->pixels_count; i++)
+    {
+        if (memcmp(&xc.backend->colors[i], &color, sizeof(Color)) == 0)
+            return xc.backend->pixels[i];
+    }
+    return pixel_from_color(xc, color);
+}
+
+static Backend_context *backend_init(Display_context dc)
+{
+    Backend_context *bc = malloc(sizeof(Backend_context));
+
+    if (bc != NULL)
+    {
+        /* Colors of the bands are allocated once and for all */
+        bc->gc = XCreateGC(dc.x.display, dc.x.window, 0, NULL);
+        /* Nobody would read the events sent by copies of obscured areas */
+        XSetGraphicsExposures(dc.x.display, bc->gc, False);
+        for (int i = 0; i < dc.gradients_count; i++)
+            bc->gradients[i] = banded_from_gradient(dc.x, dc.gradients[i]);
+
+        /* So are the plain colors, drawn with the same GC as the label,
+         * whose font is already loaded on the server */
+        bc->pixels_count = 0;
+        add_pixels(dc.x, bc, dc.paintscheme.normal);
+        add_pixels(dc.x, bc, dc.paintscheme.overflow);
+        add_pixels(dc.x, bc, dc.paintscheme.alt);
+        add_pixels(dc.x, bc, dc.paintscheme.altoverflow);
+        if (dc.x.font != NULL)
+            XSetFont(dc.x.display, bc->gc, dc.x.font->fid);
+
+        /* And so are the icons */
+        bc->icons_count = dc.icons_count;
+        for (int i = 0; i < dc.icons_count; i++)
+            bc->icons[i] = icon_from_image(dc.x, dc.icons[i]);
+
+        /* And the shapes of the rounded corners */
+        bc->masks_count = dc.masks_count;
+        for (int i = 0; i < dc.masks_count; i++)
+            bc->masks[i] = gc_from_coverage(dc.x, dc.masks[i]);
+
+        /* And the ring of a radial gauge */
+        bc->gauge = dc.gauge;
+        bc->ring =
+            dc.gauge.strip != NULL ? gc_from_gauge(dc.x, dc.gauge) : None;
+    }
+
+    return bc;
+}
+
+static void backend_destroy(X_context xc)
+{
+    if (xc.backend != NULL)
+    {
+        XFreeGC(xc.display, xc.backend->gc);
+        for (int i = 0; i < xc.backend->masks_count; i++)
+            XFreeGC(xc.display, xc.backend->masks[i]);
+        if (xc.backend->ring != None)
+            XFreeGC(xc.display, xc.backend->ring);
+        for (int i = 0; i < xc.backend->icons_count; i++)
+        {
+            if (xc.backend->icons[i].pixmap != None)
+            {
+                XFreeGC(xc.display, xc.backend->icons[i].gc);
+                XFreePixmap(xc.display, xc.backend->icons[i].pixmap);
+            }
+        }
+        free(xc.backend);
+    }
+}
+
+static void fill_rectangle(X_context xc, Color color, int x, int y,
+                           unsigned int w, unsigned int h)
+{
+    if (xc.backend == NULL)
+        return;
+
+    XSetForeground(xc.display, xc.backend->gc, find_pixel(xc, color));
+    XFillRectangle(xc.display, xc.window, xc.backend->gc, x, y, w, h);
+}
+
+static void fill_bands(X_context xc, GC gc, int gradient, int x, int y,
+                       unsigned int w, unsigned int h)
+{
+    Banded_gradient *banded = &xc.backend->gradients[gradient];
+    int start = banded->vertical ? y : x;
+    int end = start + (int)(banded->vertical ? h : w);
+
+    for (int i = 0; i < banded->count; i++)
+    {
+        int low = banded->low[i] > start ? banded->low[i] : start;
+        int high = banded->high[i] < end ? banded->high[i] : end;
+
+        if (low < high)
+        {
+            XSetForeground(xc.display, gc, banded->pixels[i]);
+            if (banded->vertical)
+                XFillRectangle(xc.display, xc.window, gc, x, low, w,
+                               high - low);
+            else
+                XFillRectangle(xc.display, xc.window, gc, low, y, high - low,
+                               h);
+        }
+    }
+}
+
+/* A gradient is drawn over the bounding box of the rectangles, which are
+ * then used as a clip */
+static void fill_rectangles(X_context xc, Paint paint,
+                            const XRectangle *rectangles, int count)
+{
+    if (xc.backend == NULL || count <= 0)
+        return;
+
+    GC gc = xc.backend->gc;
+    if (paint.gradient == NO_GRADIENT)
+    {
+        XSetForeground(xc.display, gc, find_pixel(xc, paint.color));
+        XFillRectangles(xc.display, xc.window, gc, (XRectangle *)rectangles,
+                        count);
+        return;
+    }
+
+    int x1 = rectangles[0].x;
+    int y1 = rectangles[0].y;
+    int x2 = x1;
+    int y2 = y1;
+    for (int i = 0; i < count; i++)
+    {
+        XRectangle r = rectangles[i];
+        x1 = r.x < x1 ? r.x : x1;
+        y1 = r.y < y1 ? r.y : y1;
+        x2 = r.x + r.width > x2 ? r.x + r.width : x2;
+        y2 = r.y + r.height > y2 ? r.y + r.height : y2;
+    }
+    XSetClipRectangles(xc.display, gc, 0, 0, (XRectangle *)rectangles, count,
+                       Unsorted);
+    fill_bands(xc, gc, paint.gradient, x1, y1, x2 - x1, y2 - y1);
+    XSetClipMask(xc.display, gc, None);
+}
+
+static void copy_area(X_context xc, int x, int y, unsigned int w,
+                      unsigned int h, int dest_x, int dest_y)
+{
+    if (xc.backend != NULL)
+        XCopyArea(xc.display, xc.window, xc.window, xc.backend->gc, x, y, w, h,
+                  dest_x, dest_y);
+}
+
+static void fill_gradient(X_context xc, int gradient, int x, int y,
+                          unsigned int w, unsigned int h)
+{
+    if (xc.backend != NULL)
+        fill_bands(xc, xc.backend->gc, gradient, x, y, w, h);
+}
+
+/* Layers are painted over each other without blending: the outline stays
+ * square and the other layers are clipped to their shape */
+static void fill_layer(X_context xc, Paint paint, int mask, Bool replace,
+                       int x, int y, unsigned int w, unsigned int h)
+{
+    (void)replace;
+
+    if (xc.backend == NULL || mask >= xc.backend->masks_count)
+        return;
+
+    GC gc = mask == OUTLINE_MASK ? xc.backend->gc : xc.backend->masks[mask];
+    if (paint.gradient != NO_GRADIENT)
+        fill_bands(xc, gc, paint.gradient, x, y, w, h);
+    else
+    {
+        XSetForeground(xc.display, gc, find_pixel(xc, paint.color));
+        XFillRectangle(xc.display, xc.window, gc, x, y, w, h);
+    }
+}
+
+/* Parts of the ring are pie slices clipped to the ring, without
+ * antialiasing. A gradient is approximated by its middle band. */
+static void fill_arc(X_context xc, Paint paint, int first, int last)
+{
+    if (xc.backend == NULL || xc.backend->ring == None)
+        return;
+
+    Gauge gauge = xc.backend->gauge;
+    unsigned long pixel;
+    if (paint.gradient != NO_GRADIENT)
+    {
+        Banded_gradient *banded = &xc.backend->gradients[paint.gradient];
+        pixel = banded->pixels[banded->count / 2];
+    }
+    else
+        pixel = find_pixel(xc, paint.color);
+
+    XSetForeground(xc.display, xc.backend->ring, pixel);
+    XFillArc(xc.display, xc.window, xc.backend->ring, gauge.x, gauge.y,
+             gauge.size, gauge.size,
+             GAUGE_START_ANGLE + GAUGE_SWEEP_ANGLE * first / GAUGE_SEGMENTS,
+             GAUGE_SWEEP_ANGLE * (last - first) / GAUGE_SEGMENTS);
+}
+
+static void draw_text(X_context xc, Color c, int x, int y, const char *text,
+                      int length)
+{
+    if (xc.backend == NULL || xc.font == NULL)
+        return;
+
+    XSetForeground(xc.display, xc.backend->gc, find_pixel(xc, c));
+    XDrawString(xc.display, xc.window, xc.backend->gc, x, y, text, length);
+}
+
+static void draw_icon(X_context xc, int icon, int x, int y)
+{
+    if (xc.backend == NULL || xc.backend->icons[icon].pixmap == None)
+        return;
+
+    Xlib_icon *xicon = &xc.backend->icons[icon];
+    if (xicon->clip_x != x || xicon->clip_y != y)
+    {
+        XSetClipOrigin(xc.display, xicon->gc, x, y);
+        xicon->clip_x = x;
+        xicon->clip_y = y;
+    }
+    XCopyArea(xc.display, xicon->pixmap, xc.window, xicon->gc, 0, 0,
+              xicon->width, xicon->height, x, y);
+}
+
+/* Without an alpha channel, the compositing manager does not matter */
+static Bool backend_event(X_context xc, XEvent *event)
+{
+    (void)xc;
+    (void)event;
+    return False;
+}
+
+static Depth get_display_context_depth(Display_context dc)
 {
     return (Depth){.depth = DefaultDepth(dc.x.display, dc.x.screen_number),
                    .visuals = DefaultVisual(dc.x.display, dc.x.screen_number),
                    .nvisuals = 1};
 }
+
+/* Core requests work on any display */
+static Bool supports(Display *display)
+{
+    (void)display;
+    return True;
+}
+
+const Renderer xlib_renderer = {
+    .name = "xlib",
+    .needs_display = True,
+    .follows_compositor = False,
+    .supports = supports,
+    .get_depth = get_display_context_depth,
+    .init = backend_init,
+    .destroy = backend_destroy,
+    .fill_rectangle = fill_rectangle,
+    .fill_rectangles = fill_rectangles,
+    .draw_text = draw_text,
+    .draw_icon = draw_icon,
+    .fill_layer = fill_layer,
+    .copy_area = copy_area,
+    .fill_gradient = fill_gradient,
+    .fill_arc = fill_arc,
+    .event = backend_event,
+};
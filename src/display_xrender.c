@@ -17,8 +17,16 @@
  */
 
 #include "display.h"
+#include <X11/Xutil.h>
+#include <X11/extensions/Xfixes.h>
 #include <X11/extensions/Xrender.h>
+#include <X11/extensions/shape.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* Label, foreground, background and border colors of each color set */
+#define SOLID_FILLS 16
 
 static Bool is_alpha_visual(Display_context dc, Visual *visual)
 {
@@ -69,6 +77,19 @@ static Depth get_alpha_depth_if_available(Display_context dc)
     return depth;
 }
 
+/* Selection owned by the compositing manager of the screen */
+static Atom compositor_selection(X_context xc)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "_NET_WM_CM_S%d", xc.screen_number);
+    return XInternAtom(xc.display, name, False);
+}
+
+static Bool is_compositor_running(X_context xc)
+{
+    return XGetSelectionOwner(xc.display, compositor_selection(xc)) != None;
+}
+
 static XRenderColor xrendercolor_from_color(Color color)
 {
     unsigned short alpha = color.alpha * 257;
@@ -78,25 +99,619 @@ static XRenderColor xrendercolor_from_color(Color color)
                           .blue = (color.blue * 257 * alpha) / 0xffffU};
 }
 
-void fill_rectangle(X_context xc, Color c, int x, int y, unsigned int w,
-                    unsigned int h)
+/* Gradient stops are not premultiplied */
+static XRenderColor xrendercolor_stop_from_color(Color color)
+{
+    return (XRenderColor){.alpha = color.alpha * 257,
+                          .red = color.red * 257,
+                          .green = color.green * 257,
+                          .blue = color.blue * 257};
+}
+
+struct Backend_context
+{
+    GC gc;
+    /* Everything is drawn through the same picture of the window */
+    Picture window;
+    int gradients_count;
+    Picture gradients[GRADIENTS_MAX];
+    GlyphSet glyphset;
+    XRenderPictFormat *glyph_format;
+    int solid_fills_count;
+    Color solid_colors[SOLID_FILLS];
+    Picture solid_fills[SOLID_FILLS];
+    int masks_count;
+    Picture masks[MASKS_COUNT];
+    int icons_count;
+    Picture icons[ICONS_MAX];
+    unsigned int icon_widths[ICONS_MAX];
+    unsigned int icon_heights[ICONS_MAX];
+    /* Without a compositing manager, the rounded outline is cut out of the
+     * window by its shape */
+    Bool composited;
+    Pixmap shape;
+    /* Depth of a new window while a compositing manager runs */
+    int composited_depth;
+    /* The tessellated ring of a radial gauge, drawn through an A8 mask */
+    Bool gauge;
+    XRenderPictFormat *arc_format;
+    XPointFixed strip[2 * (GAUGE_SEGMENTS + 1)];
+};
+
+static Picture picture_from_gradient(Display *display, Gradient gradient)
+{
+    XLinearGradient line = {.p1 = {.x = XDoubleToFixed(gradient.x1),
+                                   .y = XDoubleToFixed(gradient.y1)},
+                            .p2 = {.x = XDoubleToFixed(gradient.x2),
+                                   .y = XDoubleToFixed(gradient.y2)}};
+    XFixed stops[2] = {XDoubleToFixed(0), XDoubleToFixed(1)};
+    XRenderColor colors[2] = {xrendercolor_stop_from_color(gradient.start),
+                              xrendercolor_stop_from_color(gradient.end)};
+    XRenderPictureAttributes attributes = {.repeat = RepeatPad};
+
+    Picture picture =
+        XRenderCreateLinearGradient(display, &line, stops, colors, 2);
+    XRenderChangePicture(display, picture, CPRepeat, &attributes);
+    return picture;
+}
+
+static XCharStruct char_metrics(XFontStruct *font, unsigned char c)
+{
+    if (font->per_char != NULL && c >= font->min_char_or_byte2 &&
+        c <= font->max_char_or_byte2)
+        return font->per_char[c - font->min_char_or_byte2];
+    else
+        return font->max_bounds;
+}
+
+/* Rasterize the characters of LABEL_CHARSET with a core font once and upload
+ * them as A8 glyphs so that drawing a label needs no font at all */
+static GlyphSet glyphset_from_font(X_context xc, XRenderPictFormat *format)
+{
+    XFontStruct *font = xc.font;
+    GlyphSet glyphset = XRenderCreateGlyphSet(xc.display, format);
+    Pixmap pixmap = XCreatePixmap(
+        xc.display, xc.window,
+        font->max_bounds.rbearing - font->min_bounds.lbearing + 1,
+        font->max_bounds.ascent + font->max_bounds.descent + 1, 1);
+    GC gc = XCreateGC(xc.display, pixmap, 0, NULL);
+
+    XSetFont(xc.display, gc, font->fid);
+
+    for (const char *c = LABEL_CHARSET; *c != '\0'; c++)
+    {
+        XCharStruct metrics = char_metrics(font, *c);
+        Glyph glyph = (unsigned char)*c;
+        XGlyphInfo info = {.width = metrics.rbearing - metrics.lbearing,
+                           .height = metrics.ascent + metrics.descent,
+                           .x = -metrics.lbearing,
+                           .y = metrics.ascent,
+                           .xOff = metrics.width,
+                           .yOff = 0};
+        /* Rows of A8 glyph images are padded to 32 bits */
+        int stride = (info.width + 3) & ~3;
+        char *data = calloc(stride * info.height + 1, 1);
+
+        if (data != NULL && info.width > 0 && info.height > 0)
+        {
+            XSetForeground(xc.display, gc, 0);
+            XFillRectangle(xc.display, pixmap, gc, 0, 0, info.width,
+                           info.height);
+            XSetForeground(xc.display, gc, 1);
+            XDrawString(xc.display, pixmap, gc, info.x, info.y, c, 1);
+
+            XImage *image = XGetImage(xc.display, pixmap, 0, 0, info.width,
+                                      info.height, 1, ZPixmap);
+            if (image != NULL)
+            {
+                for (int y = 0; y < info.height; y++)
+                    for (int x = 0; x < info.width; x++)
+                        data[y * stride + x] =
+                            XGetPixel(image, x, y) ? 0xff : 0x00;
+                XDestroyImage(image);
+            }
+        }
+        if (data != NULL)
+        {
+            XRenderAddGlyphs(xc.display, glyphset, &glyph, &info, 1, data,
+                             stride * info.height);
+            free(data);
+        }
+    }
+
+    XFreeGC(xc.display, gc);
+    XFreePixmap(xc.display, pixmap);
+    return glyphset;
+}
+
+static int host_byte_order(void)
+{
+    unsigned int one = 1;
+    return *(unsigned char *)&one == 1 ? LSBFirst : MSBFirst;
+}
+
+/* Upload an image as a server-side ARGB picture */
+static Picture picture_from_image(X_context xc, Image image)
+{
+    Pixmap pixmap = XCreatePixmap(xc.display, xc.window, image.width,
+                                  image.height, 32);
+    GC gc = XCreateGC(xc.display, pixmap, 0, NULL);
+    XImage *ximage =
+        XCreateImage(xc.display, NULL, 32, ZPixmap, 0, (char *)image.pixels,
+                     image.width, image.height, 32, 0);
+    Picture picture = None;
+
+    if (ximage != NULL)
+    {
+        ximage->byte_order = host_byte_order();
+        XPutImage(xc.display, pixmap, gc, ximage, 0, 0, 0, 0, image.width,
+                  image.height);
+        /* The pixels are not owned by the XImage */
+        ximage->data = NULL;
+        XDestroyImage(ximage);
+
+        picture = XRenderCreatePicture(
+            xc.display, pixmap,
+            XRenderFindStandardFormat(xc.display, PictStandardARGB32), 0,
+            NULL);
+    }
+
+    XFreeGC(xc.display, gc);
+    XFreePixmap(xc.display, pixmap);
+    return picture;
+}
+
+/* Create a solid fill for a color unless there already is one */
+static void add_solid_fill(X_context xc, Backend_context *bc, Color color)
+{
+    for (int i = 0; i < bc->solid_fills_count; i++)
+    {
+        if (memcmp(&bc->solid_colors[i], &color, sizeof(Color)) == 0)
+            return;
+    }
+    if (bc->solid_fills_count < SOLID_FILLS)
+    {
+        XRenderColor xrc = xrendercolor_from_color(color);
+        bc->solid_colors[bc->solid_fills_count] = color;
+        bc->solid_fills[bc->solid_fills_count++] =
+            XRenderCreateSolidFill(xc.display, &xrc);
+    }
+}
+
+static void add_solid_fills(X_context xc, Backend_context *bc, Paints paints)
+{
+    add_solid_fill(xc, bc, paints.fg.color);
+    add_solid_fill(xc, bc, paints.bg.color);
+    add_solid_fill(xc, bc, paints.border.color);
+    add_solid_fill(xc, bc, paints.label);
+}
+
+static Picture find_solid_fill(Backend_context *bc, Color color)
+{
+    for (int i = 0; i < bc->solid_fills_count; i++)
+    {
+        if (memcmp(&bc->solid_colors[i], &color, sizeof(Color)) == 0)
+            return bc->solid_fills[i];
+    }
+    return None;
+}
+
+/* Upload the part of a layer that is not covered by the next one as an A8
+ * picture, so that layers drawn with PictOpAdd blend into each other along
+ * the rounded corners */
+static Picture picture_from_ring(X_context xc, Coverage outer,
+                                 const Coverage *inner)
+{
+    /* Rows of A8 images are padded to 32 bits */
+    int stride = (outer.width + 3) & ~3;
+    char *data = calloc(stride * outer.height, 1);
+    Pixmap pixmap =
+        XCreatePixmap(xc.display, xc.window, outer.width, outer.height, 8);
+    GC gc = XCreateGC(xc.display, pixmap, 0, NULL);
+    XImage *ximage = NULL;
+    Picture picture = None;
+
+    if (data != NULL)
+        ximage = XCreateImage(xc.display, NULL, 8, ZPixmap, 0, data,
+                              outer.width, outer.height, 32, stride);
+
+    if (ximage != NULL)
+    {
+        for (int y = 0; y < outer.height; y++)
+        {
+            for (int x = 0; x < outer.width; x++)
+            {
+                int i = y * outer.width + x;
+                data[y * stride + x] =
+                    inner == NULL ? outer.alpha[i]
+                                  : outer.alpha[i] - inner->alpha[i];
+            }
+        }
+        XPutImage(xc.display, pixmap, gc, ximage, 0, 0, 0, 0, outer.width,
+                  outer.height);
+        XDestroyImage(ximage);
+
+        picture = XRenderCreatePicture(
+            xc.display, pixmap,
+            XRenderFindStandardFormat(xc.display, PictStandardA8), 0, NULL);
+    }
+    else
+        free(data);
+
+    XFreeGC(xc.display, gc);
+    XFreePixmap(xc.display, pixmap);
+    return picture;
+}
+
+/* Upload the pixels mostly covered by the outline as a bitmap for the shape
+ * of the window */
+static Pixmap shape_from_coverage(X_context xc, Coverage coverage)
+{
+    Pixmap shape = XCreatePixmap(xc.display, xc.window, coverage.width,
+                                 coverage.height, 1);
+    GC gc = XCreateGC(xc.display, shape, 0, NULL);
+    XImage *mask = XCreateImage(xc.display, NULL, 1, XYBitmap, 0, NULL,
+                                coverage.width, coverage.height, 8, 0);
+
+    if (mask != NULL)
+        mask->data = calloc(mask->bytes_per_line * coverage.height, 1);
+
+    if (mask != NULL && mask->data != NULL)
+    {
+        for (int y = 0; y < coverage.height; y++)
+            for (int x = 0; x < coverage.width; x++)
+                XPutPixel(mask, x, y,
+                          coverage.alpha[y * coverage.width + x] >= 0x80);
+        XPutImage(xc.display, shape, gc, mask, 0, 0, 0, 0, coverage.width,
+                  coverage.height);
+    }
+
+    if (mask != NULL)
+        XDestroyImage(mask);
+    XFreeGC(xc.display, gc);
+    return shape;
+}
+
+/* Cut the window to the outline unless its transparent pixels are composited
+ * with what lies under it */
+static void update_shape(X_context xc, Backend_context *bc)
+{
+    if (bc->shape != None)
+        XShapeCombineMask(xc.display, xc.window, ShapeBounding, 0, 0,
+                          bc->composited && xc.depth == 32 ? None
+                                                           : bc->shape,
+                          ShapeSet);
+}
+
+/* Receive an event whenever the compositing manager starts or stops */
+static void watch_compositor(X_context xc)
+{
+    int event_base;
+    int error_base;
+    int major = 5;
+    int minor = 0;
+
+    if (XFixesQueryExtension(xc.display, &event_base, &error_base) &&
+        XFixesQueryVersion(xc.display, &major, &minor))
+        XFixesSelectSelectionInput(
+            xc.display, RootWindow(xc.display, xc.screen_number),
+            compositor_selection(xc),
+            XFixesSetSelectionOwnerNotifyMask |
+                XFixesSelectionWindowDestroyNotifyMask |
+                XFixesSelectionClientCloseNotifyMask);
+}
+
+/* Pictures of windows are only created once, along with the backend: this
+ * takes a round trip to the X server */
+static Picture create_window_picture(X_context xc)
 {
-    XRenderColor xrc = xrendercolor_from_color(c);
     XWindowAttributes attrib;
     XGetWindowAttributes(xc.display, xc.window, &attrib);
     XRenderPictFormat *pfmt =
         XRenderFindVisualFormat(xc.display, attrib.visual);
 
-    Picture pict = XRenderCreatePicture(xc.display, xc.window, pfmt, 0, 0);
-    XRenderFillRectangle(xc.display, PictOpSrc, pict, &xrc, x, y, w, h);
-    XRenderFreePicture(xc.display, pict);
+    return XRenderCreatePicture(xc.display, xc.window, pfmt, 0, 0);
 }
 
-Depth get_display_context_depth(Display_context dc)
+static Backend_context *backend_init(Display_context dc)
+{
+    Backend_context *bc = malloc(sizeof(Backend_context));
+    Depth adepth;
+
+    if (bc != NULL)
+    {
+        /* Nobody would read the events sent by copies of obscured areas */
+        bc->gc = XCreateGC(dc.x.display, dc.x.window, 0, NULL);
+        XSetGraphicsExposures(dc.x.display, bc->gc, False);
+        bc->window = create_window_picture(dc.x);
+
+        /* Gradients are built once and for all */
+        bc->gradients_count = dc.gradients_count;
+        for (int i = 0; i < dc.gradients_count; i++)
+            bc->gradients[i] =
+                picture_from_gradient(dc.x.display, dc.gradients[i]);
+
+        /* So are the glyphs and colors of the label */
+        bc->glyphset = None;
+        if (dc.x.font != NULL)
+        {
+            bc->glyph_format =
+                XRenderFindStandardFormat(dc.x.display, PictStandardA8);
+            bc->glyphset = glyphset_from_font(dc.x, bc->glyph_format);
+
+        }
+
+        /* Solid fills are the sources of text and of rounded layers */
+        bc->solid_fills_count = 0;
+        add_solid_fills(dc.x, bc, dc.paintscheme.normal);
+        add_solid_fills(dc.x, bc, dc.paintscheme.overflow);
+        add_solid_fills(dc.x, bc, dc.paintscheme.alt);
+        add_solid_fills(dc.x, bc, dc.paintscheme.altoverflow);
+
+        /* Rounded corners */
+        bc->masks_count = dc.masks_count;
+        for (int i = 0; i < dc.masks_count; i++)
+            bc->masks[i] = picture_from_ring(
+                dc.x, dc.masks[i], i + 1 < dc.masks_count ? &dc.masks[i + 1]
+                                                          : NULL);
+
+        /* And so are the icons */
+        bc->icons_count = dc.icons_count;
+        for (int i = 0; i < dc.icons_count; i++)
+        {
+            bc->icons[i] = picture_from_image(dc.x, dc.icons[i]);
+            bc->icon_widths[i] = dc.icons[i].width;
+            bc->icon_heights[i] = dc.icons[i].height;
+        }
+
+        /* The strip of triangles of a radial gauge is kept as is */
+        bc->gauge = dc.gauge.strip != NULL;
+        bc->arc_format =
+            XRenderFindStandardFormat(dc.x.display, PictStandardA8);
+        for (int i = 0; bc->gauge && i < 2 * (GAUGE_SEGMENTS + 1); i++)
+            bc->strip[i] = (XPointFixed){.x = dc.gauge.strip[i].x,
+                                         .y = dc.gauge.strip[i].y};
+
+        /* The shape of the window follows the compositing manager */
+        bc->shape = None;
+        if (dc.masks_count > 0 && dc.geometry.outline_radius > 0)
+            bc->shape = shape_from_coverage(dc.x, dc.masks[OUTLINE_MASK]);
+        bc->composited = is_compositor_running(dc.x);
+        adepth = get_alpha_depth_if_available(dc);
+        bc->composited_depth = adepth.nvisuals == 1
+                                   ? adepth.depth
+                                   : DefaultDepth(dc.x.display,
+                                                  dc.x.screen_number);
+        watch_compositor(dc.x);
+        update_shape(dc.x, bc);
+    }
+
+    return bc;
+}
+
+static void backend_destroy(X_context xc)
+{
+    if (xc.backend != NULL)
+    {
+        XFreeGC(xc.display, xc.backend->gc);
+        XRenderFreePicture(xc.display, xc.backend->window);
+        if (xc.backend->shape != None)
+            XFreePixmap(xc.display, xc.backend->shape);
+        for (int i = 0; i < xc.backend->gradients_count; i++)
+            XRenderFreePicture(xc.display, xc.backend->gradients[i]);
+        if (xc.backend->glyphset != None)
+            XRenderFreeGlyphSet(xc.display, xc.backend->glyphset);
+        for (int i = 0; i < xc.backend->solid_fills_count; i++)
+            XRenderFreePicture(xc.display, xc.backend->solid_fills[i]);
+        for (int i = 0; i < xc.backend->masks_count; i++)
+        {
+            if (xc.backend->masks[i] != None)
+                XRenderFreePicture(xc.display, xc.backend->masks[i]);
+        }
+        for (int i = 0; i < xc.backend->icons_count; i++)
+        {
+            if (xc.backend->icons[i] != None)
+                XRenderFreePicture(xc.display, xc.backend->icons[i]);
+        }
+        free(xc.backend);
+    }
+}
+
+static void fill_rectangle(X_context xc, Color c, int x, int y,
+                           unsigned int w, unsigned int h)
+{
+    XRenderColor xrc = xrendercolor_from_color(c);
+
+    if (xc.backend != NULL)
+        XRenderFillRectangle(xc.display, PictOpSrc, xc.backend->window, &xrc,
+                             x, y, w, h);
+}
+
+/* A gradient is composited over the bounding box of the rectangles, which
+ * are used as a clip until then */
+static void fill_rectangles(X_context xc, Paint paint,
+                            const XRectangle *rectangles, int count)
+{
+    if (xc.backend == NULL || count <= 0)
+        return;
+
+    Picture pict = xc.backend->window;
+    if (paint.gradient == NO_GRADIENT)
+    {
+        XRenderColor xrc = xrendercolor_from_color(paint.color);
+        XRenderFillRectangles(xc.display, PictOpSrc, pict, &xrc, rectangles,
+                              count);
+    }
+    else
+    {
+        XRenderPictureAttributes unclipped = {.clip_mask = None};
+        int x1 = rectangles[0].x;
+        int y1 = rectangles[0].y;
+        int x2 = x1;
+        int y2 = y1;
+        for (int i = 0; i < count; i++)
+        {
+            XRectangle r = rectangles[i];
+            x1 = r.x < x1 ? r.x : x1;
+            y1 = r.y < y1 ? r.y : y1;
+            x2 = r.x + r.width > x2 ? r.x + r.width : x2;
+            y2 = r.y + r.height > y2 ? r.y + r.height : y2;
+        }
+        XRenderSetPictureClipRectangles(xc.display, pict, 0, 0, rectangles,
+                                        count);
+        XRenderComposite(xc.display, PictOpSrc,
+                         xc.backend->gradients[paint.gradient], None, pict,
+                         x1, y1, 0, 0, x1, y1, x2 - x1, y2 - y1);
+        XRenderChangePicture(xc.display, pict, CPClipMask, &unclipped);
+    }
+}
+
+static void copy_area(X_context xc, int x, int y, unsigned int w,
+                      unsigned int h, int dest_x, int dest_y)
+{
+    if (xc.backend != NULL)
+        XCopyArea(xc.display, xc.window, xc.window, xc.backend->gc, x, y, w, h,
+                  dest_x, dest_y);
+}
+
+static void fill_gradient(X_context xc, int gradient, int x, int y,
+                          unsigned int w, unsigned int h)
+{
+    if (xc.backend == NULL)
+        return;
+
+    /* Gradients are in window coordinates: the rectangle acts as a clip */
+    XRenderComposite(xc.display, PictOpSrc, xc.backend->gradients[gradient],
+                     None, xc.backend->window, x, y, 0, 0, x, y, w, h);
+}
+
+static void fill_layer(X_context xc, Paint paint, int mask, Bool replace,
+                       int x, int y, unsigned int w, unsigned int h)
+{
+    if (xc.backend == NULL || mask >= xc.backend->masks_count ||
+        xc.backend->masks[mask] == None)
+        return;
+
+    Picture source = paint.gradient == NO_GRADIENT
+                         ? find_solid_fill(xc.backend, paint.color)
+                         : xc.backend->gradients[paint.gradient];
+    if (source == None)
+        return;
+
+    /* Sources and masks are all in window coordinates */
+    XRenderComposite(xc.display, replace ? PictOpSrc : PictOpAdd, source,
+                     xc.backend->masks[mask], xc.backend->window, x, y, x, y,
+                     x, y, w, h);
+}
+
+static void draw_text(X_context xc, Color c, int x, int y, const char *text,
+                      int length)
+{
+    if (xc.backend == NULL || xc.backend->glyphset == None)
+        return;
+
+    Picture fill = find_solid_fill(xc.backend, c);
+    if (fill == None)
+        return;
+
+    /* A single request for the whole text */
+    XRenderCompositeString8(xc.display, PictOpOver, fill, xc.backend->window,
+                            xc.backend->glyph_format, xc.backend->glyphset, 0,
+                            0, x, y, text, length);
+}
+
+static void draw_icon(X_context xc, int icon, int x, int y)
+{
+    if (xc.backend == NULL || xc.backend->icons[icon] == None)
+        return;
+
+    XRenderComposite(xc.display, PictOpOver, xc.backend->icons[icon], None,
+                     xc.backend->window, 0, 0, 0, 0, x, y,
+                     xc.backend->icon_widths[icon],
+                     xc.backend->icon_heights[icon]);
+}
+
+/* A part of the ring is a window of the cached strip, blended over the
+ * inside of the gauge with antialiased edges */
+static void fill_arc(X_context xc, Paint paint, int first, int last)
+{
+    if (xc.backend == NULL || !xc.backend->gauge)
+        return;
+
+    Picture source = paint.gradient == NO_GRADIENT
+                         ? find_solid_fill(xc.backend, paint.color)
+                         : xc.backend->gradients[paint.gradient];
+    if (source == None)
+        return;
+
+    /* Sources are in window coordinates: the source is aligned on the
+     * first point */
+    XPointFixed *points = xc.backend->strip + 2 * first;
+    XRenderCompositeTriStrip(xc.display, PictOpOver, source,
+                             xc.backend->window, xc.backend->arc_format,
+                             points[0].x >> 16, points[0].y >> 16, points,
+                             2 * (last - first + 1));
+}
+
+static Depth get_display_context_depth(Display_context dc)
 {
     Depth depth = {.depth = DefaultDepth(dc.x.display, dc.x.screen_number),
                    .visuals = DefaultVisual(dc.x.display, dc.x.screen_number),
                    .nvisuals = 1};
-    Depth adepth = get_alpha_depth_if_available(dc);
+    Depth adepth;
+
+    /* The alpha channel is useless and only slows drawing down without a
+     * compositing manager */
+    if (!is_compositor_running(dc.x))
+        return depth;
+    adepth = get_alpha_depth_if_available(dc);
     return adepth.nvisuals == 1 ? adepth : depth;
 }
+
+static Bool backend_event(X_context xc, XEvent *event)
+{
+    int event_base;
+    int error_base;
+    int depth;
+    XFixesSelectionNotifyEvent *notify = (XFixesSelectionNotifyEvent *)event;
+
+    if (xc.backend == NULL ||
+        !XFixesQueryExtension(xc.display, &event_base, &error_base) ||
+        event->type != event_base + XFixesSelectionNotify ||
+        notify->selection != compositor_selection(xc))
+        return False;
+
+    xc.backend->composited = notify->subtype == XFixesSetSelectionOwnerNotify;
+    update_shape(xc, xc.backend);
+    depth = xc.backend->composited
+                ? xc.backend->composited_depth
+                : DefaultDepth(xc.display, xc.screen_number);
+    return depth != xc.depth;
+}
+
+static Bool supports(Display *display)
+{
+    int event_base;
+    int error_base;
+
+    return XRenderQueryExtension(display, &event_base, &error_base);
+}
+
+const Renderer xrender_renderer = {
+    .name = "xrender",
+    .needs_display = True,
+    .follows_compositor = True,
+    .supports = supports,
+    .get_depth = get_display_context_depth,
+    .init = backend_init,
+    .destroy = backend_destroy,
+    .fill_rectangle = fill_rectangle,
+    .fill_rectangles = fill_rectangles,
+    .draw_text = draw_text,
+    .draw_icon = draw_icon,
+    .fill_layer = fill_layer,
+    .copy_area = copy_area,
+    .fill_gradient = fill_gradient,
+    .fill_arc = fill_arc,
+    .event = backend_event,
+};
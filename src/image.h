@@ -0,0 +1,39 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+
+typedef struct
+{
+    int width;
+    int height;
+    /* Premultiplied 0xAARRGGBB pixels row by row, NULL if loading failed */
+    unsigned int *pixels;
+} Image;
+
+/* Decode an image file, reporting errors on stderr */
+Image load_image(const char *path);
+void image_free(Image image);
+
+/* Size of the pixel data */
+size_t image_size(Image image);
+
+#endif /* __IMAGE_H__ */
@@ -0,0 +1,40 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "image.h"
+#include <stdio.h>
+
+Image load_image(const char *path)
+{
+    fprintf(stderr,
+            "Error: could not load icon %s (xob is built without icon "
+            "support).\n",
+            path);
+    return (Image){.width = 0, .height = 0, .pixels = NULL};
+}
+
+void image_free(Image image)
+{
+    (void)image;
+}
+
+size_t image_size(Image image)
+{
+    (void)image;
+    return 0;
+}
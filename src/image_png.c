@@ -0,0 +1,83 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "image.h"
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int premultiply(unsigned char c, unsigned char alpha)
+{
+    return (c * alpha + 127) / 255;
+}
+
+Image load_image(const char *path)
+{
+    Image image = {.width = 0, .height = 0, .pixels = NULL};
+    png_image png;
+    unsigned char *rgba;
+
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+
+    if (png_image_begin_read_from_file(&png, path))
+    {
+        png.format = PNG_FORMAT_RGBA;
+        rgba = malloc(PNG_IMAGE_SIZE(png));
+        image.pixels = malloc(sizeof(unsigned int) * png.width * png.height);
+
+        if (rgba != NULL && image.pixels != NULL &&
+            png_image_finish_read(&png, NULL, rgba, 0, NULL))
+        {
+            image.width = png.width;
+            image.height = png.height;
+            for (int i = 0; i < image.width * image.height; i++)
+            {
+                unsigned char *p = rgba + 4 * i;
+                image.pixels[i] = (unsigned int)p[3] << 24 |
+                                  premultiply(p[0], p[3]) << 16 |
+                                  premultiply(p[1], p[3]) << 8 |
+                                  premultiply(p[2], p[3]);
+            }
+        }
+        else
+        {
+            free(image.pixels);
+            image.pixels = NULL;
+        }
+        free(rgba);
+    }
+
+    if (image.pixels == NULL)
+        fprintf(stderr, "Error: could not load icon %s (%s).\n", path,
+                png.warning_or_error ? png.message : "out of memory");
+
+    png_image_free(&png);
+    return image;
+}
+
+void image_free(Image image)
+{
+    free(image.pixels);
+}
+
+size_t image_size(Image image)
+{
+    return sizeof(unsigned int) * image.width * image.height;
+}
@@ -0,0 +1,385 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include "input.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum
+{
+    PARSED,
+    INCOMPLETE,
+    UNEXPECTED
+} Parse_status;
+
+void style_index_init(Style_index *index, const char *names[], int count)
+{
+    index->count = 0;
+    index->warn = true;
+    for (int i = 0; i < count && i < XOB_STYLES_MAX; i++)
+    {
+        /* Insertion sort, there are only a few styles */
+        int j = index->count++;
+        while (j > 0 && strcmp(index->names[j - 1], names[i]) > 0)
+        {
+            index->names[j] = index->names[j - 1];
+            index->styles[j] = index->styles[j - 1];
+            j--;
+        }
+        index->names[j] = names[i];
+        index->styles[j] = i;
+    }
+}
+
+/* Position of the style with a name that is not null-terminated */
+static int find_style(const Style_index *index, const char *name,
+                      size_t length)
+{
+    int low = 0;
+    int high = index != NULL ? index->count - 1 : -1;
+
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        int order = strncmp(index->names[middle], name, length);
+        /* The name may stop short of length at a null byte of the input */
+        if (order == 0 && strlen(index->names[middle]) != length)
+            order = strlen(index->names[middle]) > length ? 1 : -1;
+
+        if (order == 0)
+            return index->styles[middle];
+        else if (order < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+
+    if (index == NULL || index->warn)
+        fprintf(stderr, "Warning: unknown style %.*s.\n", (int)length, name);
+    return 0;
+}
+
+/* Parse a value at the beginning of some text that does not start with
+ * spaces: a decimal integer, optionally followed by "@" and the name of a
+ * style, optionally followed by "#" and the time it was emitted, followed by
+ * one character, "!" for the alternative mode. The number of characters
+ * consumed is stored in *consumed. */
+static Parse_status parse_value(const char *text, size_t length, bool end,
+                                const Style_index *styles, Input_value *value,
+                                size_t *consumed)
+{
+    size_t i = 0;
+    bool negative = false;
+    long long number = 0;
+    int style = 0;
+    long long emitted = -1;
+
+    if (i < length && (text[i] == '-' || text[i] == '+'))
+        negative = text[i++] == '-';
+    if (i == length)
+        return end ? UNEXPECTED : INCOMPLETE;
+    if (!isdigit((unsigned char)text[i]))
+        return UNEXPECTED;
+
+    while (i < length && isdigit((unsigned char)text[i]))
+    {
+        number = number > INT_MAX ? number : number * 10 + (text[i] - '0');
+        i++;
+    }
+    number = number > INT_MAX ? INT_MAX : number;
+    if (i == length && !end)
+        return INCOMPLETE;
+
+    if (i < length && text[i] == '@')
+    {
+        size_t name = ++i;
+        while (i < length && !isspace((unsigned char)text[i]) &&
+               text[i] != '!' && text[i] != '#')
+            i++;
+        if (i == length && !end)
+            return INCOMPLETE;
+        style = find_style(styles, text + name, i - name);
+    }
+
+    if (i < length && text[i] == '#')
+    {
+        emitted = 0;
+        while (++i < length && isdigit((unsigned char)text[i]))
+            emitted = emitted > LLONG_MAX / 10
+                          ? emitted
+                          : emitted * 10 + (text[i] - '0');
+        if (i == length && !end)
+            return INCOMPLETE;
+    }
+
+    value->valid = true;
+    value->value = negative ? -number : number;
+    value->style = style;
+    value->emitted = emitted;
+    value->show_mode = i < length && text[i] == '!' ? ALTERNATIVE : NORMAL;
+    *consumed = i < length ? i + 1 : i;
+    return PARSED;
+}
+
+void record_input(FILE *trace, const Style_index *styles, Input_value value)
+{
+    struct timespec now;
+    const char *name = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* The default style goes without a name */
+    for (int i = 0; value.style != 0 && i < styles->count; i++)
+        if (styles->styles[i] == value.style)
+            name = styles->names[i];
+
+    fprintf(trace, "%lld %d%s%s%s\n",
+            (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000, value.value,
+            name != NULL ? "@" : "", name != NULL ? name : "",
+            value.show_mode == ALTERNATIVE ? "!" : "");
+}
+
+bool parse_input(Input_buffer *buffer, bool end, const Style_index *styles,
+                 Input_value *newest, int *count)
+{
+    size_t start = 0;
+    size_t consumed;
+    Parse_status status = PARSED;
+
+    *count = 0;
+
+    while (status == PARSED)
+    {
+        while (start < buffer->length &&
+               isspace((unsigned char)buffer->data[start]))
+            start++;
+        if (start == buffer->length)
+            break;
+        status = parse_value(buffer->data + start, buffer->length - start, end,
+                             styles, newest, &consumed);
+        if (status == PARSED)
+        {
+            start += consumed;
+            (*count)++;
+            if (buffer->trace != NULL)
+                record_input(buffer->trace, styles, *newest);
+        }
+    }
+
+    /* Keep the beginning of the next value */
+    memmove(buffer->data, buffer->data + start, buffer->length - start);
+    buffer->length -= start;
+
+    /* A value cannot be longer than the whole buffer */
+    if (status == INCOMPLETE && buffer->length == INPUT_BUFFER_SIZE)
+        status = UNEXPECTED;
+
+    return status != UNEXPECTED;
+}
+
+bool read_input(int fd, Input_buffer *buffer, const Style_index *styles,
+                Input_value *newest, int *count)
+{
+    ssize_t bytes_read;
+    bool end;
+
+    *count = 0;
+
+    bytes_read = read(fd, buffer->data + buffer->length,
+                      INPUT_BUFFER_SIZE - buffer->length);
+    if (bytes_read < 0)
+        return errno == EINTR || errno == EAGAIN;
+    end = bytes_read == 0;
+    buffer->length += bytes_read;
+
+    return parse_input(buffer, end, styles, newest, count) && !end;
+}
+
+/* Layout of the slot of a mailbox */
+#define SLOT_VALUE_BITS 32
+#define SLOT_MODE_BIT (1ULL << SLOT_VALUE_BITS)
+#define SLOT_STYLE_SHIFT (SLOT_VALUE_BITS + 1)
+#define SLOT_STYLE_MASK 0xffU
+#define SLOT_SEQUENCE_SHIFT (SLOT_STYLE_SHIFT + 8)
+#define SLOT_SEQUENCE_MASK ((1U << (64 - SLOT_SEQUENCE_SHIFT)) - 1)
+#define CAP_SEQUENCE_SHIFT 32
+
+bool open_mailbox(Input_mailbox *mailbox)
+{
+    mailbox->slot = 0;
+    mailbox->cap = 0;
+    mailbox->emitted = -1;
+    mailbox->closed = 0;
+    mailbox->posted = 0;
+    mailbox->sequence = 0;
+
+    if (pipe(mailbox->wakeup) != 0)
+        return false;
+    fcntl(mailbox->wakeup[0], F_SETFL, O_NONBLOCK);
+    fcntl(mailbox->wakeup[1], F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+void post_input(Input_mailbox *mailbox, Input_value newest, int count)
+{
+    post_input_cap(mailbox, newest, count, 0);
+}
+
+void post_input_cap(Input_mailbox *mailbox, Input_value newest, int count,
+                    int cap)
+{
+    unsigned long long slot;
+
+    mailbox->posted = (mailbox->posted + count) & SLOT_SEQUENCE_MASK;
+    slot = (unsigned long long)mailbox->posted << SLOT_SEQUENCE_SHIFT |
+           (unsigned long long)newest.style << SLOT_STYLE_SHIFT |
+           (newest.show_mode == ALTERNATIVE ? SLOT_MODE_BIT : 0) |
+           (unsigned int)newest.value;
+    /* The emission time may belong to a newer value than the slot read
+     * along with it, which only shifts the latency of a skipped value */
+    __atomic_store_n(&mailbox->emitted, newest.emitted, __ATOMIC_RELAXED);
+    __atomic_store_n(&mailbox->cap,
+                     (unsigned long long)mailbox->posted << CAP_SEQUENCE_SHIFT |
+                         (unsigned int)cap,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&mailbox->slot, slot, __ATOMIC_RELEASE);
+
+    /* A full pipe already means that a value is waiting */
+    (void)!write(mailbox->wakeup[1], "", 1);
+}
+
+void close_input(Input_mailbox *mailbox)
+{
+    __atomic_store_n(&mailbox->closed, 1, __ATOMIC_RELEASE);
+    (void)!write(mailbox->wakeup[1], "", 1);
+}
+
+void free_mailbox(Input_mailbox *mailbox)
+{
+    close(mailbox->wakeup[0]);
+    close(mailbox->wakeup[1]);
+}
+
+static void *input_thread(void *argument)
+{
+    Input_mailbox *mailbox = argument;
+    Input_buffer buffer = {.length = 0, .trace = mailbox->trace};
+    Input_value newest = {.valid = false};
+    struct pollfd input = {.fd = mailbox->fd, .events = POLLIN};
+    bool listening = true;
+    int count;
+
+    /* The thread is only cancelled while it waits for input */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    while (listening)
+    {
+        /* Blocks on the input only, never on the X server */
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        poll(&input, 1, -1);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        listening = read_input(mailbox->fd, &buffer, mailbox->styles,
+                               &newest, &count);
+        if (count > 0)
+            post_input(mailbox, newest, count);
+    }
+
+    close_input(mailbox);
+    return NULL;
+}
+
+bool start_input_thread(Input_mailbox *mailbox, int fd,
+                        const Style_index *styles, FILE *trace)
+{
+    mailbox->fd = fd;
+    mailbox->styles = styles;
+    mailbox->trace = trace;
+
+    if (!open_mailbox(mailbox))
+        return false;
+
+    if (pthread_create(&mailbox->thread, NULL, input_thread, mailbox) != 0)
+    {
+        free_mailbox(mailbox);
+        return false;
+    }
+    return true;
+}
+
+bool take_input(Input_mailbox *mailbox, Input_value *newest, int *count)
+{
+    int cap;
+
+    return take_input_cap(mailbox, newest, count, &cap);
+}
+
+bool take_input_cap(Input_mailbox *mailbox, Input_value *newest, int *count,
+                    int *cap)
+{
+    char wakeups[64];
+    unsigned long long slot;
+    unsigned long long capped;
+    unsigned int sequence;
+    bool closed;
+
+    while (read(mailbox->wakeup[0], wakeups, sizeof(wakeups)) > 0)
+        continue;
+
+    /* The last value is published before the mailbox is closed */
+    closed = __atomic_load_n(&mailbox->closed, __ATOMIC_ACQUIRE);
+
+    /* A newer maximum than the value means that the poster is between its
+     * two stores, the slot is read again until they match */
+    do
+    {
+        slot = __atomic_load_n(&mailbox->slot, __ATOMIC_ACQUIRE);
+        capped = __atomic_load_n(&mailbox->cap, __ATOMIC_RELAXED);
+        sequence = slot >> SLOT_SEQUENCE_SHIFT;
+    } while ((capped >> CAP_SEQUENCE_SHIFT) != sequence);
+
+    *count = (sequence - mailbox->sequence) & SLOT_SEQUENCE_MASK;
+    if (*count > 0)
+    {
+        newest->valid = true;
+        newest->value = (int)(unsigned int)(slot & 0xffffffffULL);
+        newest->show_mode = slot & SLOT_MODE_BIT ? ALTERNATIVE : NORMAL;
+        newest->style = slot >> SLOT_STYLE_SHIFT & SLOT_STYLE_MASK;
+        newest->emitted =
+            __atomic_load_n(&mailbox->emitted, __ATOMIC_RELAXED);
+        *cap = (int)(unsigned int)(capped & 0xffffffffULL);
+        mailbox->sequence = sequence;
+    }
+
+    return !closed;
+}
+
+void stop_input_thread(Input_mailbox *mailbox)
+{
+    /* The input may not be over, e.g. when xob exits for being idle */
+    if (!__atomic_load_n(&mailbox->closed, __ATOMIC_ACQUIRE))
+        pthread_cancel(mailbox->thread);
+    pthread_join(mailbox->thread, NULL);
+    free_mailbox(mailbox);
+}
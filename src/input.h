@@ -0,0 +1,144 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "display.h"
+#include "xob.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Bytes of input read at once. Values written faster than they are read pile
+ * up here and only the newest one is kept. */
+#define INPUT_BUFFER_SIZE 4096
+
+typedef struct
+{
+    bool valid;
+    int value;
+    Show_mode show_mode;
+    /* Position of the style selected by name, 0 by default */
+    int style;
+    /* Time the value was emitted in microseconds on CLOCK_MONOTONIC, -1 if
+     * unknown */
+    long long emitted;
+} Input_value;
+
+/* Names of the styles that values can select ("50@mute"), sorted once so
+ * that they are found by a binary search */
+typedef struct
+{
+    const char *names[XOB_STYLES_MAX];
+    int styles[XOB_STYLES_MAX];
+    int count;
+    /* Whether unknown names are reported on stderr, true by default */
+    bool warn;
+} Style_index;
+
+/* Index styles by name, given in the order of their positions */
+void style_index_init(Style_index *index, const char *names[], int count);
+
+/* Append a value to a trace, preceded by the time it is recorded in
+ * microseconds on CLOCK_MONOTONIC and written as it would be read */
+void record_input(FILE *trace, const Style_index *styles, Input_value value);
+
+/* Input read so far that does not end with a complete value yet */
+typedef struct
+{
+    char data[INPUT_BUFFER_SIZE];
+    size_t length;
+    /* Every value parsed is recorded there if not NULL */
+    FILE *trace;
+} Input_buffer;
+
+/* Parse every complete value in a buffer, whose style names are looked up
+ * in an index, and keep the beginning of the next one. At the end of the
+ * input, a value does not need to be followed by anything. The newest value
+ * replaces *newest and the number of values parsed is stored in *count.
+ * Returns false after unexpected input. */
+bool parse_input(Input_buffer *buffer, bool end, const Style_index *styles,
+                 Input_value *newest, int *count);
+
+/* Read what is available on a file descriptor and parse every complete value,
+ * whose style names are looked up in an index. The newest value replaces
+ * *newest and the number of values parsed is stored in *count. Returns false
+ * at the end of the input or after unexpected input. */
+bool read_input(int fd, Input_buffer *buffer, const Style_index *styles,
+                Input_value *newest, int *count);
+
+/* The newest value posted by a thread to another one, published without
+ * locks. The slot packs a sequence number counting the values posted, the
+ * style, the show mode and the value in a single word. A byte is written to
+ * the wakeup pipe whenever the slot changes. */
+typedef struct
+{
+    unsigned long long slot;
+    /* Maximum of the newest value under the sequence number of its slot,
+     * written before the slot */
+    unsigned long long cap;
+    /* Emission time of the newest value, written before the slot */
+    long long emitted;
+    int closed;
+    int fd;
+    const Style_index *styles;
+    FILE *trace;
+    int wakeup[2];
+    /* Sequence numbers of the poster and of the taker */
+    unsigned int posted;
+    unsigned int sequence;
+    pthread_t thread;
+} Input_mailbox;
+
+/* Open an empty mailbox. Returns false if its wakeup pipe cannot be
+ * created. */
+bool open_mailbox(Input_mailbox *mailbox);
+
+/* Post the newest of count values without ever blocking */
+void post_input(Input_mailbox *mailbox, Input_value newest, int count);
+
+/* Likewise along with the maximum of the newest value */
+void post_input_cap(Input_mailbox *mailbox, Input_value newest, int count,
+                    int cap);
+
+/* Tell the taker that nothing else will be posted */
+void close_input(Input_mailbox *mailbox);
+
+void free_mailbox(Input_mailbox *mailbox);
+
+/* Start a thread reading values from a file descriptor into a mailbox,
+ * recording them in a trace if not NULL. Returns false if it could not be
+ * started. */
+bool start_input_thread(Input_mailbox *mailbox, int fd,
+                        const Style_index *styles, FILE *trace);
+
+/* Take the newest value out of the mailbox once its wakeup pipe is readable.
+ * The newest value replaces *newest and the number of values posted since
+ * the last call is stored in *count. Returns false once the mailbox is
+ * closed. */
+bool take_input(Input_mailbox *mailbox, Input_value *newest, int *count);
+
+/* Likewise, the maximum posted along with the newest value replacing *cap */
+bool take_input_cap(Input_mailbox *mailbox, Input_value *newest, int *count,
+                    int *cap);
+
+/* Stop the thread, cancelled if it is still waiting for input */
+void stop_input_thread(Input_mailbox *mailbox);
+
+#endif
@@ -15,29 +15,160 @@
  * along with xob.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#define _XOPEN_SOURCE 500
+#define _XOPEN_SOURCE 600
 
 #include "main.h"
+#include "activation.h"
+#include "allocations.h"
 #include "conf.h"
-#include "display.h"
-#include <limits.h>
+#include "mirror.h"
+#include "output.h"
+#include "realtime.h"
+#include "shared.h"
+#include "watch.h"
+#include "xob.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
+#include <time.h>
 #include <unistd.h>
 
+/* Events of the bar written on the standard output */
+typedef struct
+{
+    Output output;
+    /* Values read along with a newer one, never shown */
+    int skipped;
+    /* Written at once by a worker thread rather than by the main loop */
+    bool immediate;
+    /* Time the bar was hidden in milliseconds on CLOCK_MONOTONIC, -1 while
+     * it is shown, read by the main loop */
+    long long hidden;
+    /* Times xob was activated through its socket and its first value was
+     * read in microseconds, reported along with its frame. -1 if none.
+     * Written by the main loop, possibly read by a worker thread. */
+    long long activated;
+    long long read;
+} Events;
+
+static long long microseconds_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void write_event(const Xob_event *event, void *data)
+{
+    Events *events = data;
+    long long activated;
+    long long read_time;
+
+    switch (event->type)
+    {
+    case XOB_UPDATE:
+        if (event->dropped + events->skipped > 0)
+            output_drop(&events->output, event->time,
+                        event->dropped + events->skipped);
+        events->skipped = 0;
+        __atomic_store_n(&events->hidden, -1, __ATOMIC_RELEASE);
+        /* Nothing is allocated any more once the bar is up */
+        allocations_watch();
+        activated = __atomic_exchange_n(&events->activated, -1,
+                                        __ATOMIC_ACQUIRE);
+        if (activated >= 0)
+        {
+            read_time = __atomic_load_n(&events->read, __ATOMIC_RELAXED);
+            fprintf(stderr,
+                    "Info: first frame %.1f ms after the activation, the "
+                    "value being read after %.1f ms.\n",
+                    (microseconds_now() - activated) / 1000.0,
+                    (read_time - activated) / 1000.0);
+        }
+        output_update(&events->output, event->time, event->value, event->cap,
+                      event->alternative ? ALTERNATIVE : NORMAL);
+        break;
+    case XOB_HIDE:
+        __atomic_store_n(&events->hidden, event->time, __ATOMIC_RELEASE);
+        output_hide(&events->output, event->time);
+        break;
+    }
+
+    if (events->immediate)
+        output_flush(&events->output);
+}
+
+/* Milliseconds left before xob exits for being idle, after the bar has been
+ * hidden with no input since. -1 while the bar is shown. */
+static long long idle_left(Events *events, long long last_input, int idle)
+{
+    long long hidden = __atomic_load_n(&events->hidden, __ATOMIC_ACQUIRE);
+    long long left;
+
+    if (hidden < 0)
+        return -1;
+    left = (hidden > last_input ? hidden : last_input) + idle -
+           microseconds_now() / 1000;
+    return left > 0 ? left : 0;
+}
+
+/* Set by SIGINT and SIGTERM along with an input that has no end (a record in
+ * shared memory or a socket): the main loop then ends as at the end of the
+ * input */
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int signal)
+{
+    (void)signal;
+    interrupted = 1;
+}
+
+/* Show a value on the bar, or on the bars of all the displays, read after
+ * the main loop woke up at a given time */
+static void show_value(Xob *xob, Mirror mirrors[], int mirrors_count,
+                       Input_value value, int count, int cap, long long woken)
+{
+    if (xob != NULL)
+    {
+        xob_select_style(xob, value.style);
+        xob_set_wakeup(xob, woken);
+        xob_show_at(xob, value.value, cap, value.show_mode == ALTERNATIVE,
+                    value.emitted);
+    }
+    for (int i = 0; i < mirrors_count; i++)
+        post_mirror(&mirrors[i], value, count, cap);
+}
+
 int main(int argc, char *argv[])
 {
     int cap = 100;
     int timeout = 1000;
+    int idle = 0;
+    bool threaded = false;
+    int trace_sample = 0;
+    Realtime realtime = {.policy = REALTIME_OFF};
+    Output_format output_format = OUTPUT_TEXT;
 
     char *arg_config_file_path = NULL;
-    char *style_name = DEFAULT_STYLE;
+    const char *style_names[XOB_STYLES_MAX] = {DEFAULT_STYLE};
+    int styles_count = 0;
+    const char *display_names[MIRRORS_MAX] = {NULL};
+    int displays_count = 0;
+    Style_index style_index;
+    char *value_file_path = NULL;
+    char *max_file_path = NULL;
+    char *trace_file_path = NULL;
+    char *shared_path = NULL;
+    FILE *trace = NULL;
 
     /* Command-line arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "m:t:c:s:qvh")) != -1)
+    while ((opt = getopt(argc, argv, "m:t:I:c:s:d:b:f:M:S:TL:R:r:o:qvh")) != -1)
     {
         switch (opt)
         {
@@ -70,14 +201,94 @@ int main(int argc, char *argv[])
                     "Warning: timeout is low, the bar may not be visible.\n");
             }
             break;
+        case 'I':
+            idle = atoi(optarg);
+            if (idle < 0)
+            {
+                fprintf(stderr, "Invalid idle time: must be a natural "
+                                "number.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'c':
             arg_config_file_path = optarg;
             break;
         case 's':
-            style_name = optarg;
+            if (styles_count == XOB_STYLES_MAX)
+            {
+                fprintf(stderr, "Invalid style: at most %d styles.\n",
+                        XOB_STYLES_MAX);
+                exit(EXIT_FAILURE);
+            }
+            style_names[styles_count++] = optarg;
+            break;
+        case 'd':
+            if (displays_count == MIRRORS_MAX)
+            {
+                fprintf(stderr, "Invalid display: at most %d displays.\n",
+                        MIRRORS_MAX);
+                exit(EXIT_FAILURE);
+            }
+            display_names[displays_count++] = optarg;
+            break;
+        case 'b':
+            if (!xob_set_backend(optarg))
+            {
+                fprintf(stderr, "Invalid backend: expected \"xrender\", "
+                                "\"xlib\" or \"null\".\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            value_file_path = optarg;
+            break;
+        case 'M':
+            max_file_path = optarg;
+            break;
+        case 'S':
+            shared_path = optarg;
+            break;
+        case 'T':
+            threaded = true;
+            break;
+        case 'L':
+            trace_sample = atoi(optarg);
+            if (trace_sample <= 0)
+            {
+                fprintf(stderr, "Invalid latency sampling: must be a "
+                                "non-zero natural number.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'R':
+            if (!realtime_parse(&realtime, optarg))
+            {
+                fprintf(stderr, "Invalid real-time mode: expected \"lock\", "
+                                "\"fifo[:priority]\", \"rr[:priority]\" or "
+                                "\"nice[:value]\".\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'r':
+            trace_file_path = optarg;
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0)
+                output_format = OUTPUT_TEXT;
+            else if (strcmp(optarg, "lines") == 0)
+                output_format = OUTPUT_LINES;
+            else if (strcmp(optarg, "json") == 0)
+                output_format = OUTPUT_JSON;
+            else
+            {
+                fprintf(stderr, "Invalid output format: expected \"text\", "
+                                "\"lines\" or \"json\".\n");
+                exit(EXIT_FAILURE);
+            }
             break;
         case 'q':
             freopen("/dev/null", "w", stdout);
+            output_format = OUTPUT_NONE;
             break;
         case 'v':
             printf("Version %s\n", VERSION_NUMBER);
@@ -85,8 +296,10 @@ int main(int argc, char *argv[])
             break;
         default:
             fprintf(stderr,
-                    "Usage: %s [-m maximum] [-t timeout] [-c configfile] [-s "
-                    "style]\n\n",
+                    "Usage: %s [-m maximum] [-t timeout] [-I idle] [-c "
+                    "configfile] [-s style] [-d display] [-b backend] [-f "
+                    "valuefile [-M maxfile] | -S record] [-T] [-L sample] "
+                    "[-R mode] [-r tracefile] [-o format]\n\n",
                     argv[0]);
             fprintf(stderr, "    -m <non-zero natural>"
                             " maximum value (0 is always the minimum)\n");
@@ -95,10 +308,42 @@ int main(int argc, char *argv[])
                     " duration in milliseconds between an update and the "
                     "vanishing of the bar "
                     "after an update or 0 if always on screen\n");
+            fprintf(stderr, "    -I <natural>         "
+                            " exit after the bar has been hidden that many "
+                            "milliseconds with no input, 0 never\n");
             fprintf(stderr, "    -c <filepath>        "
                             " configuration file specifying styles\n");
             fprintf(stderr, "    -s <style name>      "
-                            " style to use from the configuration file\n");
+                            " style to use from the configuration file, "
+                            "repeated to preload styles selected by "
+                            "value@style\n");
+            fprintf(stderr, "    -d <display>         "
+                            " X display, repeated to mirror the bar on "
+                            "several displays\n");
+            fprintf(stderr, "    -b <backend>         "
+                            " rendering backend: xrender, xlib or null "
+                            "(headless)\n");
+            fprintf(stderr, "    -f <filepath>        "
+                            " watch a file for the value instead of "
+                            "reading the standard input\n");
+            fprintf(stderr, "    -M <filepath>        "
+                            " file with the maximum value along with -f\n");
+            fprintf(stderr, "    -S <filepath>        "
+                            " read the values from a record in shared "
+                            "memory (e.g. /dev/shm/xob)\n");
+            fprintf(stderr, "    -T                   "
+                            " read the input in a separate thread\n");
+            fprintf(stderr, "    -L <non-zero natural>"
+                            " trace latencies, confirming one update out "
+                            "of that many with the X server\n");
+            fprintf(stderr, "    -R <mode>            "
+                            " warm up and lock the memory, then run the "
+                            "main loop under a policy: lock, fifo, rr or "
+                            "nice\n");
+            fprintf(stderr, "    -r <filepath>        "
+                            " record the values read with their time\n");
+            fprintf(stderr, "    -o <format>          "
+                            " output format: text, lines or json\n");
             fprintf(stderr, "    -q                   "
                             " suppress all normal output\n");
             fprintf(stderr, "    -v                   "
@@ -107,154 +352,361 @@ int main(int argc, char *argv[])
         }
     }
 
-    /* Style */
-    FILE *config_file = NULL;
-    Style style = DEFAULT_CONFIGURATION;
-    char xdg_config_file_path[PATH_MAX];
-    char real_config_file_path[PATH_MAX];
+    if (max_file_path != NULL && value_file_path == NULL)
+    {
+        fprintf(stderr, "Invalid max file: a value file is needed (-f).\n");
+        exit(EXIT_FAILURE);
+    }
+    if (shared_path != NULL && value_file_path != NULL)
+    {
+        fprintf(stderr, "Invalid record: values are read from a value file "
+                        "(-f).\n");
+        exit(EXIT_FAILURE);
+    }
 
-    /* Case #1: config file in argument */
-    if (arg_config_file_path != NULL)
+    /* Values are recorded with their time to be replayed later */
+    if (trace_file_path != NULL)
     {
-        if (realpath(arg_config_file_path, real_config_file_path) != NULL)
+        trace = fopen(trace_file_path, "w");
+        if (trace == NULL)
         {
-            config_file = fopen(real_config_file_path, "r");
+            fprintf(stderr, "Error: could not open trace file %s.\n",
+                    trace_file_path);
+            exit(EXIT_FAILURE);
         }
-        else
+    }
+
+    /* A socket passed by a service manager replaces the standard input */
+    Activation activation;
+    bool activated = value_file_path == NULL && shared_path == NULL &&
+                     activation_open(&activation, trace);
+    bool endless = activated || shared_path != NULL;
+    /* The first value is timed from the activation to its frame */
+    bool starting = activated;
+    if (activated)
+        fprintf(stderr, "Info: reading values from the %s socket passed "
+                        "to xob.\n",
+                activation.stream ? "stream" : "datagram");
+
+    /* Interruptions are only delivered to the main loop while it waits, the
+     * threads started from now on keep them blocked */
+    sigset_t interruptions;
+    sigset_t waiting_mask;
+    if (endless)
+    {
+        struct sigaction action = {.sa_handler = interrupt};
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        sigemptyset(&interruptions);
+        sigaddset(&interruptions, SIGINT);
+        sigaddset(&interruptions, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &interruptions, &waiting_mask);
+    }
+
+    /* Styles preloaded and looked up by name in the input */
+    if (styles_count == 0)
+        styles_count = 1;
+    style_index_init(&style_index, style_names, styles_count);
+
+    /* Display */
+    bool listening = true;
+    Input_buffer input_buffer = {.length = 0, .trace = trace};
+    Input_mailbox input_mailbox;
+    int input_fd = STDIN_FILENO;
+    Input_value input_value = {.valid = false, .emitted = -1};
+    int input_count;
+    Events events = {.skipped = 0,
+                     .immediate = false,
+                     .hidden = microseconds_now() / 1000,
+                     .activated = -1};
+    long long last_input = events.hidden;
+    File_watcher watcher;
+    bool watching = value_file_path != NULL;
+    Shared_input shared;
+    bool sharing = shared_path != NULL;
+    Mirror mirrors[MIRRORS_MAX];
+    int mirrors_count = 0;
+    int reporting = 0;
+    Xob *xob = NULL;
+    unsigned long allocations = 0;
+
+    output_init(&events.output, output_format, STDOUT_FILENO);
+
+    /* Several displays are each driven by a worker thread, the events of the
+     * first one that opens are written by its worker */
+    if (displays_count > 1)
+    {
+        if (!xob_init_threads())
+            fprintf(stderr, "Warning: Xlib does not support threads.\n");
+        events.immediate = true;
+        for (int i = 0; i < displays_count; i++)
         {
-            fprintf(stderr,
-                    "Error: could not open specified configuration file.\n");
-            fprintf(stderr,
-                    "Info: falling back to standard configuration files.\n");
+            mirrors[mirrors_count] = (Mirror){
+                .display_name = display_names[i],
+                .config_path = arg_config_file_path,
+                .style_names = style_names,
+                .styles_count = styles_count,
+                .timeout = timeout,
+                .trace_sample = trace_sample,
+                .listener = write_event,
+                .listener_data = &events,
+                .reporting = &reporting,
+                .skipped = &events.skipped};
+            if (start_mirror(&mirrors[mirrors_count]))
+                mirrors_count++;
+            else
+                fprintf(stderr, "Error: could not start the thread of "
+                                "display %s.\n",
+                        display_names[i]);
         }
     }
-
-    /* Case #2: the XDG_CONFIG_HOME environment variable is set */
-    if (config_file == NULL && getenv("XDG_CONFIG_HOME") != NULL)
+    else
     {
-        if (snprintf(xdg_config_file_path, PATH_MAX, "%s/%s/%s",
-                     getenv("XDG_CONFIG_HOME"), DEFAULT_CONFIG_APPNAME,
-                     DEFAULT_CONFIG_FILENAME) < PATH_MAX)
+        xob = xob_open_display(display_names[0], arg_config_file_path,
+                               style_names, styles_count);
+        if (xob == NULL)
         {
-            if (realpath(xdg_config_file_path, real_config_file_path) != NULL)
-            {
-                config_file = fopen(real_config_file_path, "r");
-            }
+            fprintf(stderr, "Error: Cannot open display\n");
+            exit(EXIT_FAILURE);
         }
     }
 
-    /* Case #3: falling back to default configuration directory */
-    if (config_file == NULL)
     {
-        if (snprintf(xdg_config_file_path, PATH_MAX, "%s/.config/%s/%s",
-                     getenv("HOME"), DEFAULT_CONFIG_APPNAME,
-                     DEFAULT_CONFIG_FILENAME) < PATH_MAX)
+        fd_set fds;
+        fd_set write_fds;
+        fd_set except_fds;
+        struct timespec ts;
+        int xob_fd = xob != NULL ? xob_get_fd(xob) : -1;
+        int max_fd;
+        int xob_timeout;
+        long long idle_timeout;
+        long long woken;
+
+        /* Events are written in batches, once per iteration of the main
+         * loop */
+        if (xob != NULL)
+        {
+            xob_set_timeout(xob, timeout);
+            xob_set_trace(xob, trace_sample);
+            xob_set_listener(xob, write_event, &events);
+        }
+
+        /* Watched files replace the standard input */
+        if (watching)
         {
-            if (realpath(xdg_config_file_path, real_config_file_path) != NULL)
+            if (!watcher_open(&watcher, value_file_path, max_file_path))
             {
-                config_file = fopen(real_config_file_path, "r");
+                for (int i = 0; i < mirrors_count; i++)
+                    stop_mirror(&mirrors[i]);
+                if (xob != NULL)
+                    xob_close(xob);
+                exit(EXIT_FAILURE);
             }
+            threaded = false;
         }
-    }
 
-    /* Case #4: system wide configuration */
-    if (config_file == NULL)
-    {
-        if (realpath(SYSCONFDIR "/" DEFAULT_CONFIG_APPNAME
-                                "/" DEFAULT_CONFIG_FILENAME,
-                     real_config_file_path) != NULL)
+        /* So does a record in shared memory, which needs no reader
+         * thread */
+        else if (sharing)
         {
-            config_file = fopen(real_config_file_path, "r");
+            if (!shared_open(&shared, shared_path))
+            {
+                for (int i = 0; i < mirrors_count; i++)
+                    stop_mirror(&mirrors[i]);
+                if (xob != NULL)
+                    xob_close(xob);
+                exit(EXIT_FAILURE);
+            }
+            input_fd = shared.fd;
+            threaded = false;
         }
-    }
 
-    /* Parsing the config file */
-    printf("Info: reading configuration from %s.\n", real_config_file_path);
-    style = parse_style_config(config_file, style_name, style);
-    fclose(config_file);
+        else if (activated)
+            threaded = false;
 
-    /* Display */
-    bool displayed = false;
-    bool listening = true;
-    Input_value input_value;
-    Display_context display_context = init(style);
+        /* A reader thread keeps reading the input while the X server is
+         * slow, the main loop waits for its wakeups instead */
+        else if (threaded)
+        {
+            if (start_input_thread(&input_mailbox, STDIN_FILENO,
+                                   &style_index, trace))
+                input_fd = input_mailbox.wakeup[0];
+            else
+            {
+                fprintf(stderr, "Error: could not start the input thread.\n");
+                threaded = false;
+            }
+        }
 
-    if (display_context.x.display == NULL)
-    {
-        fprintf(stderr, "Error: Cannot open display\n");
-        exit(EXIT_FAILURE);
-    }
-    else
-    {
-        fd_set fds;
-        struct timeval tv;
+        /* The render path is drawn once and locked in memory when
+         * everything is set up, only the main loop runs under the
+         * policy */
+        if (realtime.policy != REALTIME_OFF)
+        {
+            if (xob != NULL)
+                xob_warm(xob);
+            realtime_enter(realtime);
+        }
 
         /* Main loop */
-        while (listening)
+        while (listening && !interrupted)
         {
-            /* Waiting for input on stdin or time to hide the gauge */
+            /* Events the reader was not ready for wait for it to be */
+            if (xob != NULL)
+                output_flush(&events.output);
+
+            /* Waiting for input on stdin or for the bar to be due for the
+             * next frame or for being hidden. No timeout if already hidden
+             * and nothing is pending. */
+            xob_timeout = xob != NULL ? xob_get_timeout(xob) : -1;
+            idle_timeout = idle > 0 ? idle_left(&events, last_input, idle) : -1;
+            if (idle_timeout == 0)
+            {
+                fprintf(stderr, "Info: idle for %d ms, exiting.\n", idle);
+                break;
+            }
+            if (idle_timeout > 0 &&
+                (xob_timeout < 0 || idle_timeout < xob_timeout))
+                xob_timeout = idle_timeout;
+            ts.tv_sec = xob_timeout / 1000;
+            ts.tv_nsec = 1000000 * (xob_timeout % 1000);
             FD_ZERO(&fds);
-            FD_SET(STDIN_FILENO, &fds);
-            tv.tv_sec = timeout / 1000;
-            tv.tv_usec = 1000 * (timeout % 1000);
-            switch (select(1, &fds, NULL, NULL,
-                           /* No timeout if already hidden */
-                           displayed && timeout > 0 ? &tv : NULL))
+            FD_ZERO(&except_fds);
+            if (watching)
+                input_fd = watcher_set_fds(&watcher, &fds, &except_fds);
+            else if (activated)
+                input_fd = activation_set_fds(&activation, &fds);
+            else
+                FD_SET(input_fd, &fds);
+            if (xob_fd >= 0)
+                FD_SET(xob_fd, &fds);
+            max_fd = input_fd > xob_fd ? input_fd : xob_fd;
+            FD_ZERO(&write_fds);
+            if (xob != NULL && output_pending(&events.output))
+            {
+                FD_SET(events.output.fd, &write_fds);
+                max_fd =
+                    events.output.fd > max_fd ? events.output.fd : max_fd;
+            }
+            switch (pselect(max_fd + 1, &fds, &write_fds, &except_fds,
+                            xob_timeout >= 0 ? &ts : NULL,
+                            endless ? &waiting_mask : NULL))
             {
             case -1:
-                perror("select()");
+                if (errno == EINTR)
+                    break;
+                perror("pselect()");
                 exit(EXIT_FAILURE);
             case 0:
-                /* Time to hide the gauge */
-                display_context = hide(display_context);
-                displayed = false;
                 break;
             default:
-                /* Update display using new input value */
-                input_value = parse_input();
-                if (input_value.valid)
+                /* Only the newest of the values read is shown. Stop at the
+                 * end of the input or after unexpected input. */
+                woken = microseconds_now();
+                if (watching)
+                {
+                    /* Every change is shown, even to the same value */
+                    if (watcher_changed(&watcher, &fds, &except_fds) &&
+                        watcher_read(&watcher, &input_value.value, &cap))
+                    {
+                        if (trace != NULL)
+                            record_input(trace, &style_index, input_value);
+                        show_value(xob, mirrors, mirrors_count, input_value,
+                                   1, cap, woken);
+                        last_input = microseconds_now() / 1000;
+                    }
+                }
+                /* Nothing to parse, only the newest record is read */
+                else if (sharing && FD_ISSET(input_fd, &fds))
+                {
+                    shared_take(&shared, &input_value, &input_count, &cap);
+                    if (input_count > 0)
+                    {
+                        if (trace != NULL)
+                            record_input(trace, &style_index, input_value);
+                        if (xob != NULL)
+                            events.skipped += input_count - 1;
+                        show_value(xob, mirrors, mirrors_count, input_value,
+                                   input_count, cap, woken);
+                        last_input = microseconds_now() / 1000;
+                    }
+                }
+                /* Values from the connections or datagrams alike */
+                else if (activated)
                 {
-                    display_context =
-                        show(display_context, input_value.value, cap,
-                             style.overflow, input_value.show_mode);
-                    printf("Update: %d/%d %s\n", input_value.value, cap,
-                           (input_value.show_mode == ALTERNATIVE) ? "[ALT]"
-                                                                  : "");
-                    displayed = true;
-                    listening = true;
+                    activation_read(&activation, &fds, &style_index,
+                                    &input_value, &input_count);
+                    if (input_count > 0)
+                    {
+                        if (starting)
+                        {
+                            __atomic_store_n(&events.read, microseconds_now(),
+                                             __ATOMIC_RELAXED);
+                            __atomic_store_n(&events.activated,
+                                             activation.activated,
+                                             __ATOMIC_RELEASE);
+                            starting = false;
+                        }
+                        if (xob != NULL)
+                            events.skipped += input_count - 1;
+                        show_value(xob, mirrors, mirrors_count, input_value,
+                                   input_count, cap, woken);
+                        last_input = microseconds_now() / 1000;
+                    }
                 }
-                else
+                else if (FD_ISSET(input_fd, &fds))
                 {
-                    /* Stop after unexpected input */
-                    listening = false;
+                    listening =
+                        threaded ? take_input(&input_mailbox, &input_value,
+                                              &input_count)
+                                 : read_input(STDIN_FILENO, &input_buffer,
+                                              &style_index, &input_value,
+                                              &input_count);
+                    if (input_count > 0)
+                    {
+                        /* Workers count the values they skip */
+                        if (xob != NULL)
+                            events.skipped += input_count - 1;
+                        show_value(xob, mirrors, mirrors_count, input_value,
+                                   input_count, cap, woken);
+                        last_input = microseconds_now() / 1000;
+                    }
                 }
                 break;
             }
+            if (xob != NULL)
+                xob_dispatch(xob);
         }
 
-        /* Clean the memory */
-        display_context_destroy(display_context);
-    }
-    return EXIT_SUCCESS;
-}
-
-Input_value parse_input(void)
-{
-    Input_value input_value;
-    char altflag;
+        if (allocations_counted(&allocations))
+            fprintf(stderr, "%s: %lu heap allocation(s) after the first "
+                            "frame.\n",
+                    allocations > 0 ? "Error" : "Info", allocations);
 
-    input_value.valid = false;
+        /* Clean the memory */
+        for (int i = 0; i < mirrors_count; i++)
+            stop_mirror(&mirrors[i]);
 
-    if (scanf("%d", &(input_value.value)) > 0)
-    {
-        /* Checking for the "alternative mode" flag : '!' */
-        if (scanf("%c", &altflag) > 0 && altflag == '!')
-            input_value.show_mode = ALTERNATIVE;
-        else
-            input_value.show_mode = NORMAL;
+        output_close(&events.output);
+        if (events.output.lost > 0)
+            fprintf(stderr, "Warning: %lu event(s) could not be written.\n",
+                    events.output.lost);
 
-        input_value.valid = true;
+        if (threaded)
+            stop_input_thread(&input_mailbox);
+        if (watching)
+            watcher_close(&watcher);
+        if (sharing)
+            shared_close(&shared);
+        if (activated)
+            activation_close(&activation);
+        if (trace != NULL)
+            fclose(trace);
+        if (xob != NULL && trace_sample > 0)
+            print_stats(stderr, display_names[0], xob_get_stats(xob));
+        if (xob != NULL)
+            xob_close(xob);
     }
-
-    return input_value;
+    return allocations > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
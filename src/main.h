@@ -18,18 +18,9 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-#include "display.h"
+#include "input.h"
 #include <stdbool.h>
 
 #define VERSION_NUMBER "0.3"
 
-typedef struct
-{
-    bool valid;
-    int value;
-    Show_mode show_mode;
-} Input_value;
-
-Input_value parse_input(void);
-
 #endif
@@ -0,0 +1,156 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include "mirror.h"
+#include "output.h"
+#include <X11/Xlib.h>
+#include <stdio.h>
+#include <sys/select.h>
+
+/* The mirror of the worker running in the current thread, NULL in the main
+ * thread */
+static __thread Mirror *worker = NULL;
+
+/* A request failing on a display is not fatal to the others */
+static int report_x_error(Display *display, XErrorEvent *error)
+{
+    fprintf(stderr, "Warning: X error %d (request %d) on display %s.\n",
+            error->error_code, error->request_code, DisplayString(display));
+    return 0;
+}
+
+/* Xlib exits once this returns: a worker losing its display ends instead,
+ * leaving the connection and its bar behind */
+static int lose_display(Display *display)
+{
+    fprintf(stderr, "Error: lost the connection to display %s.\n",
+            DisplayString(display));
+    if (worker != NULL)
+    {
+        __atomic_store_n(&worker->failed, 1, __ATOMIC_RELEASE);
+        pthread_exit(NULL);
+    }
+    return 0;
+}
+
+static void *mirror_thread(void *argument)
+{
+    Mirror *mirror = argument;
+    Input_value value = {.valid = false, .emitted = -1};
+    bool listening = true;
+    int count;
+    int cap = 100;
+    fd_set fds;
+    struct timeval tv;
+    int xob_fd;
+    int max_fd;
+    int xob_timeout;
+    int *skipped = NULL;
+    int reporting = 0;
+    Xob *xob;
+
+    worker = mirror;
+    xob = xob_open_display(mirror->display_name, mirror->config_path,
+                           mirror->style_names, mirror->styles_count);
+    if (xob == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open display %s\n",
+                mirror->display_name);
+        __atomic_store_n(&mirror->failed, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    xob_set_timeout(xob, mirror->timeout);
+    xob_set_trace(xob, mirror->trace_sample);
+
+    /* A dead display does not keep the others from writing events */
+    if (mirror->reporting != NULL &&
+        __atomic_compare_exchange_n(mirror->reporting, &reporting, 1, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        xob_set_listener(xob, mirror->listener, mirror->listener_data);
+        skipped = mirror->skipped;
+    }
+    xob_fd = xob_get_fd(xob);
+    max_fd = mirror->mailbox.wakeup[0] > xob_fd ? mirror->mailbox.wakeup[0]
+                                                : xob_fd;
+
+    /* The main loop of a single display */
+    while (listening)
+    {
+        xob_timeout = xob_get_timeout(xob);
+        tv.tv_sec = xob_timeout / 1000;
+        tv.tv_usec = 1000 * (xob_timeout % 1000);
+        FD_ZERO(&fds);
+        FD_SET(mirror->mailbox.wakeup[0], &fds);
+        if (xob_fd >= 0)
+            FD_SET(xob_fd, &fds);
+        if (select(max_fd + 1, &fds, NULL, NULL,
+                   xob_timeout >= 0 ? &tv : NULL) > 0 &&
+            FD_ISSET(mirror->mailbox.wakeup[0], &fds))
+        {
+            listening =
+                take_input_cap(&mirror->mailbox, &value, &count, &cap);
+            if (count > 0)
+            {
+                if (skipped != NULL)
+                    *skipped += count - 1;
+                xob_select_style(xob, value.style);
+                xob_show_at(xob, value.value, cap,
+                            value.show_mode == ALTERNATIVE, value.emitted);
+            }
+        }
+        xob_dispatch(xob);
+    }
+
+    if (mirror->trace_sample > 0)
+        print_stats(stderr, mirror->display_name, xob_get_stats(xob));
+    xob_close(xob);
+    return NULL;
+}
+
+bool start_mirror(Mirror *mirror)
+{
+    mirror->failed = 0;
+    XSetErrorHandler(report_x_error);
+    XSetIOErrorHandler(lose_display);
+    if (!open_mailbox(&mirror->mailbox))
+        return false;
+
+    if (pthread_create(&mirror->thread, NULL, mirror_thread, mirror) != 0)
+    {
+        free_mailbox(&mirror->mailbox);
+        return false;
+    }
+    return true;
+}
+
+void post_mirror(Mirror *mirror, Input_value newest, int count, int cap)
+{
+    if (__atomic_load_n(&mirror->failed, __ATOMIC_ACQUIRE))
+        return;
+    post_input_cap(&mirror->mailbox, newest, count, cap);
+}
+
+void stop_mirror(Mirror *mirror)
+{
+    close_input(&mirror->mailbox);
+    pthread_join(mirror->thread, NULL);
+    free_mailbox(&mirror->mailbox);
+}
@@ -0,0 +1,67 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include "input.h"
+#include "xob.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+/* At most as many X displays as styles */
+#define MIRRORS_MAX 16
+
+/* A bar on an X display of its own, driven by a worker thread fed through a
+ * mailbox. A slow or dead display only delays its own worker. */
+typedef struct
+{
+    const char *display_name;
+    const char *config_path;
+    const char **style_names;
+    int styles_count;
+    int timeout;
+    /* One update out of trace_sample is confirmed by the X server, 0 for no
+     * statistics of latencies */
+    int trace_sample;
+    /* Given to every worker, only the first one whose display opens writes
+     * the events (it sets *reporting) */
+    Xob_listener listener;
+    void *listener_data;
+    int *reporting;
+    /* Values replaced by newer ones before the reporting worker took them
+     * are added here, in that worker */
+    int *skipped;
+    /* Set by the worker if its display cannot be opened or is lost, nothing
+     * is posted to it any more */
+    int failed;
+    Input_mailbox mailbox;
+    pthread_t thread;
+} Mirror;
+
+/* Open the display of a mirror in a worker thread. From then on, X errors
+ * are reported on stderr instead of being fatal, and only the worker ends if
+ * its display is lost. Returns false if the thread cannot be started. */
+bool start_mirror(Mirror *mirror);
+
+/* Post a value to the worker without ever blocking */
+void post_mirror(Mirror *mirror, Input_value newest, int count, int cap);
+
+/* Let the worker hide its bar and close its display, and wait for it */
+void stop_mirror(Mirror *mirror);
+
+#endif
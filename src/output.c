@@ -0,0 +1,223 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include "output.h"
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void output_init(Output *output, Output_format format, int fd)
+{
+    struct stat status;
+
+    output->format = format;
+    output->fd = fd;
+    output->length = 0;
+    output->lost = 0;
+    output->kind = OUTPUT_BLOCKING;
+
+    /* A reader that does not keep up must not block the main loop. Only
+     * events are written there (the messages of xob and libxob go to
+     * stderr), but the file status flags are left alone: they are shared
+     * with stderr under 2>&1 and with the other processes of a pipeline. */
+    if (format != OUTPUT_NONE && fstat(fd, &status) == 0)
+    {
+        if (S_ISSOCK(status.st_mode))
+            output->kind = OUTPUT_SOCKET;
+        else if (S_ISFIFO(status.st_mode))
+            output->kind = OUTPUT_PIPE;
+    }
+}
+
+/* Append an event to the buffer unless it does not fit */
+static void append(Output *output, const char *format, ...)
+{
+    va_list arguments;
+    size_t room = OUTPUT_BUFFER_SIZE - output->length;
+    int length;
+
+    va_start(arguments, format);
+    length = vsnprintf(output->data + output->length, room, format, arguments);
+    va_end(arguments);
+
+    if (length >= 0 && (size_t)length < room)
+        output->length += length;
+    else
+        output->lost++;
+}
+
+void output_update(Output *output, long long time, int value, int cap,
+                   Show_mode show_mode)
+{
+    bool alt = show_mode == ALTERNATIVE;
+
+    switch (output->format)
+    {
+    case OUTPUT_NONE:
+        break;
+    case OUTPUT_TEXT:
+        append(output, "Update: %d/%d %s\n", value, cap, alt ? "[ALT]" : "");
+        break;
+    case OUTPUT_LINES:
+        append(output, "update %lld %d %d%s\n", time, value, cap,
+               alt ? " alt" : "");
+        break;
+    case OUTPUT_JSON:
+        append(output,
+               "{\"event\":\"update\",\"time\":%lld,\"value\":%d,\"cap\":%d,"
+               "\"alt\":%s}\n",
+               time, value, cap, alt ? "true" : "false");
+        break;
+    }
+}
+
+void output_hide(Output *output, long long time)
+{
+    switch (output->format)
+    {
+    case OUTPUT_NONE:
+    case OUTPUT_TEXT:
+        break;
+    case OUTPUT_LINES:
+        append(output, "hide %lld\n", time);
+        break;
+    case OUTPUT_JSON:
+        append(output, "{\"event\":\"hide\",\"time\":%lld}\n", time);
+        break;
+    }
+}
+
+void output_drop(Output *output, long long time, int count)
+{
+    switch (output->format)
+    {
+    case OUTPUT_NONE:
+    case OUTPUT_TEXT:
+        break;
+    case OUTPUT_LINES:
+        append(output, "drop %lld %d\n", time, count);
+        break;
+    case OUTPUT_JSON:
+        append(output, "{\"event\":\"drop\",\"time\":%lld,\"count\":%d}\n",
+               time, count);
+        break;
+    }
+}
+
+bool output_pending(Output *output)
+{
+    return output->length > 0;
+}
+
+/* Write without blocking: a socket is sent to as such, and a pipe only
+ * written to once it has room, no more than what it then takes at once */
+static ssize_t write_some(Output *output, const char *data, size_t length)
+{
+    struct pollfd room = {.fd = output->fd, .events = POLLOUT};
+
+    switch (output->kind)
+    {
+    case OUTPUT_SOCKET:
+        return send(output->fd, data, length, MSG_DONTWAIT);
+    case OUTPUT_PIPE:
+        if (poll(&room, 1, 0) == 0)
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+        return write(output->fd, data, length < PIPE_BUF ? length : PIPE_BUF);
+    case OUTPUT_BLOCKING:
+        break;
+    }
+    return write(output->fd, data, length);
+}
+
+/* Events in a part of the buffer */
+static unsigned long count_events(const char *data, size_t length)
+{
+    unsigned long count = 0;
+
+    for (size_t i = 0; i < length; i++)
+        count += data[i] == '\n';
+    return count;
+}
+
+void output_flush(Output *output)
+{
+    size_t written = 0;
+    ssize_t result = 0;
+
+    while (written < output->length && result >= 0)
+    {
+        result = write_some(output, output->data + written,
+                            output->length - written);
+        if (result > 0)
+            written += result;
+        else if (result < 0 && errno == EINTR)
+            result = 0;
+    }
+
+    /* Keep what the reader is not ready for, drop what cannot be written */
+    if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        output->lost += count_events(output->data + written,
+                                     output->length - written);
+        written = output->length;
+    }
+    memmove(output->data, output->data + written, output->length - written);
+    output->length -= written;
+}
+
+void output_close(Output *output)
+{
+    output_flush(output);
+    output->lost += count_events(output->data, output->length);
+    output->length = 0;
+}
+
+static void print_latency(FILE *file, const char *stage,
+                          const Xob_latency *latency)
+{
+    if (latency->count == 0)
+        fprintf(file, "%-16s %8d %8s %8s %8s %8s\n", stage, 0, "-", "-", "-",
+                "-");
+    else
+        fprintf(file, "%-16s %8lld %8lld %8lld %8lld %8lld\n", stage,
+                latency->count, latency->total / latency->count,
+                xob_latency_percentile(latency, 50),
+                xob_latency_percentile(latency, 99), latency->max);
+}
+
+void print_stats(FILE *file, const char *display_name, const Xob_stats *stats)
+{
+    fprintf(file, "Latencies in microseconds on display %s:\n",
+            display_name != NULL ? display_name : "$DISPLAY");
+    fprintf(file, "%-16s %8s %8s %8s %8s %8s\n", "stage", "count", "mean",
+            "p50", "p99", "max");
+    print_latency(file, "producer->xob", &stats->producer);
+    print_latency(file, "xob->submit", &stats->submit);
+    print_latency(file, "submit->ack", &stats->ack);
+    print_latency(file, "wakeup->flush", &stats->wakeup);
+}
@@ -0,0 +1,93 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "display.h"
+#include "xob.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Events written at once. Events that do not fit while the reader is slow
+ * are lost. */
+#define OUTPUT_BUFFER_SIZE 4096
+
+typedef enum
+{
+    /* Nothing is formatted nor written */
+    OUTPUT_NONE,
+    /* "Update: 42/100 [ALT]" for each update only */
+    OUTPUT_TEXT,
+    /* "update 1234 42 100 alt", "hide 1234", "drop 1234 3" */
+    OUTPUT_LINES,
+    /* One JSON object per line */
+    OUTPUT_JSON
+} Output_format;
+
+/* How events are written without blocking */
+typedef enum
+{
+    /* A file or a terminal, written as it comes */
+    OUTPUT_BLOCKING,
+    /* Written once polled for room */
+    OUTPUT_PIPE,
+    /* Sent without waiting */
+    OUTPUT_SOCKET
+} Output_kind;
+
+/* Events of the main loop, time-stamped in milliseconds on a monotonic
+ * clock, waiting to be written */
+typedef struct
+{
+    Output_format format;
+    int fd;
+    Output_kind kind;
+    char data[OUTPUT_BUFFER_SIZE];
+    size_t length;
+    unsigned long lost;
+} Output;
+
+/* Prepare the output of events on a file descriptor, written without
+ * blocking if it is a pipe or a socket */
+void output_init(Output *output, Output_format format, int fd);
+
+/* A value was displayed */
+void output_update(Output *output, long long time, int value, int cap,
+                   Show_mode show_mode);
+
+/* The bar was hidden */
+void output_hide(Output *output, long long time);
+
+/* Some values were skipped in favor of a newer one */
+void output_drop(Output *output, long long time, int count);
+
+/* Whether events are waiting to be written */
+bool output_pending(Output *output);
+
+/* Write as many waiting events as possible without blocking */
+void output_flush(Output *output);
+
+/* Write the waiting events a last time, those left are counted as lost */
+void output_close(Output *output);
+
+/* Write a table of the latencies of the updates of a display (NULL for the
+ * default one) */
+void print_stats(FILE *file, const char *display_name, const Xob_stats *stats);
+
+#endif
@@ -0,0 +1,151 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The writing side of the shared record, also mapped by xob -S */
+
+#define _GNU_SOURCE
+
+#include "xob-producer.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/* Attempts to start a write while another producer is writing */
+#define POST_ATTEMPTS 1000
+
+struct Xob_producer
+{
+    Xob_record *record;
+};
+
+Xob_record *xob_record_map(const char *path)
+{
+    struct stat status;
+    Xob_record *record;
+    uint32_t magic = 0;
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if (fd < 0)
+        return NULL;
+
+    /* Whoever comes first sizes the file, which is then full of zeros */
+    if (fstat(fd, &status) != 0 ||
+        (status.st_size < (off_t)sizeof(Xob_record) &&
+         ftruncate(fd, sizeof(Xob_record)) != 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    record = mmap(NULL, sizeof(Xob_record), PROT_READ | PROT_WRITE,
+                  MAP_SHARED, fd, 0);
+    close(fd);
+    if (record == MAP_FAILED)
+        return NULL;
+
+    if (!__atomic_compare_exchange_n(&record->magic, &magic, XOB_RECORD_MAGIC,
+                                     false, __ATOMIC_RELAXED,
+                                     __ATOMIC_RELAXED) &&
+        magic != XOB_RECORD_MAGIC)
+    {
+        munmap(record, sizeof(Xob_record));
+        return NULL;
+    }
+    return record;
+}
+
+void xob_record_unmap(Xob_record *record)
+{
+    munmap(record, sizeof(Xob_record));
+}
+
+Xob_producer *xob_producer_open(const char *path)
+{
+    Xob_producer *producer = malloc(sizeof(Xob_producer));
+
+    if (producer != NULL)
+    {
+        producer->record = xob_record_map(path);
+        if (producer->record == NULL)
+        {
+            free(producer);
+            producer = NULL;
+        }
+    }
+    return producer;
+}
+
+bool xob_producer_post(Xob_producer *producer, int value, int cap,
+                       bool alternative, int style)
+{
+    Xob_record *record = producer->record;
+    struct timespec now;
+    uint32_t sequence;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* An odd sequence belongs to another producer in the middle of a
+     * write, which may have died there */
+    for (int attempt = 0;; attempt++)
+    {
+        sequence = __atomic_load_n(&record->sequence, __ATOMIC_RELAXED);
+        if (!(sequence & 1) &&
+            __atomic_compare_exchange_n(&record->sequence, &sequence,
+                                        sequence + 1, false, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+            break;
+        if (attempt == POST_ATTEMPTS)
+            return false;
+        if (sequence & 1)
+            sched_yield();
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&record->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->cap, cap, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->alternative, alternative, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->style, style, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->emitted,
+                     (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000,
+                     __ATOMIC_RELAXED);
+
+    /* Ordered with the reader setting waiting before it reads the
+     * sequence: either it sees the new value or it is woken up */
+    __atomic_store_n(&record->sequence, sequence + 2, __ATOMIC_SEQ_CST);
+#ifdef __linux__
+    if (__atomic_load_n(&record->waiting, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &record->sequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    return true;
+}
+
+void xob_producer_close(Xob_producer *producer)
+{
+    if (producer != NULL)
+    {
+        xob_record_unmap(producer->record);
+        free(producer);
+    }
+}
@@ -0,0 +1,118 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include "realtime.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+/* Priorities and nice value when none is given */
+#define REALTIME_PRIORITY 10
+#define REALTIME_NICE_VALUE -10
+
+/* Stack used by the main loop below the caller, mapped before it is
+ * locked */
+#define STACK_PREFAULT (128 * 1024)
+
+bool realtime_parse(Realtime *realtime, const char *mode)
+{
+    static const struct
+    {
+        const char *name;
+        Realtime_policy policy;
+        int priority;
+    } modes[] = {
+        {"lock", REALTIME_LOCK, 0},
+        {"fifo", REALTIME_FIFO, REALTIME_PRIORITY},
+        {"rr", REALTIME_RR, REALTIME_PRIORITY},
+        {"nice", REALTIME_NICE, REALTIME_NICE_VALUE},
+    };
+    size_t length = strcspn(mode, ":");
+    char *end;
+
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        if (strlen(modes[i].name) != length ||
+            strncmp(modes[i].name, mode, length) != 0)
+            continue;
+
+        realtime->policy = modes[i].policy;
+        realtime->priority = modes[i].priority;
+        if (mode[length] == '\0')
+            return true;
+        if (modes[i].policy == REALTIME_LOCK)
+            return false;
+        realtime->priority = strtol(mode + length + 1, &end, 10);
+        return *end == '\0' && end != mode + length + 1;
+    }
+    return false;
+}
+
+/* Map the pages of the stack the main loop will use */
+static void prefault_stack(void)
+{
+    volatile char stack[STACK_PREFAULT];
+
+    for (size_t i = 0; i < sizeof(stack); i += 1024)
+        stack[i] = 0;
+}
+
+void realtime_enter(Realtime realtime)
+{
+    struct sched_param parameter = {.sched_priority = realtime.priority};
+    int policy = realtime.policy == REALTIME_FIFO ? SCHED_FIFO : SCHED_RR;
+    int error;
+
+    if (realtime.policy == REALTIME_OFF)
+        return;
+
+    /* The update path allocates nothing once the bar is up (see
+     * check_allocations), so what is mapped now is all it needs and later
+     * mappings are not locked: they could fail past RLIMIT_MEMLOCK */
+    prefault_stack();
+    if (mlockall(MCL_CURRENT) != 0)
+        fprintf(stderr, "Warning: could not lock the memory: %s.\n",
+                strerror(errno));
+
+    switch (realtime.policy)
+    {
+    case REALTIME_FIFO:
+    case REALTIME_RR:
+        error = pthread_setschedparam(pthread_self(), policy, &parameter);
+        if (error != 0)
+            fprintf(stderr,
+                    "Warning: could not run under %s priority %d: %s.\n",
+                    policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR",
+                    realtime.priority, strerror(error));
+        break;
+    case REALTIME_NICE:
+        /* The calling thread only on Linux */
+        if (setpriority(PRIO_PROCESS, 0, realtime.priority) != 0)
+            fprintf(stderr, "Warning: could not set the nice value %d: %s.\n",
+                    realtime.priority, strerror(errno));
+        break;
+    default:
+        break;
+    }
+}
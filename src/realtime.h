@@ -0,0 +1,53 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <stdbool.h>
+
+typedef enum
+{
+    REALTIME_OFF,
+    /* Lock the memory only */
+    REALTIME_LOCK,
+    REALTIME_FIFO,
+    REALTIME_RR,
+    REALTIME_NICE
+} Realtime_policy;
+
+/* Low-jitter mode of the main loop (-R): the memory of xob is locked so
+ * that the first value after hours hidden does not wait for pages to come
+ * back, and the main loop may run under a real-time scheduling policy or
+ * with a lower nice value */
+typedef struct
+{
+    Realtime_policy policy;
+    /* Priority of REALTIME_FIFO and REALTIME_RR, nice value of
+     * REALTIME_NICE */
+    int priority;
+} Realtime;
+
+/* Parse "lock", "fifo[:priority]", "rr[:priority]" or "nice[:value]".
+ * Returns false if the mode is invalid. */
+bool realtime_parse(Realtime *realtime, const char *mode);
+
+/* Lock the memory mapped so far and apply the policy to the calling thread.
+ * What fails is reported as a warning, xob then runs as usual. */
+void realtime_enter(Realtime realtime);
+
+#endif
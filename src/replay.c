@@ -0,0 +1,161 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* xob-replay: write the values of a trace recorded by xob (-r) on the
+ * standard output at their original pace, or as fast as possible, to be
+ * piped into xob again */
+
+#define _XOPEN_SOURCE 600
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Longest line of a trace */
+#define LINE_SIZE 256
+
+typedef long long Microseconds;
+
+static Microseconds monotonic_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Microseconds)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Sleep until a time on the monotonic clock, without drifting over a long
+ * trace */
+static void sleep_until(Microseconds time)
+{
+    struct timespec deadline = {.tv_sec = time / 1000000,
+                                .tv_nsec = time % 1000000 * 1000};
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) ==
+           EINTR)
+        continue;
+}
+
+int main(int argc, char *argv[])
+{
+    bool fast = false;
+    bool stamped = false;
+    FILE *trace;
+    char line[LINE_SIZE];
+    int number = 0;
+    long values = 0;
+    Microseconds first = -1;
+    Microseconds start = monotonic_now();
+    Microseconds late = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "feh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            fast = true;
+            break;
+        case 'e':
+            stamped = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-f] [-e] tracefile\n\n", argv[0]);
+            fprintf(stderr, "    -f  write the values as fast as possible\n");
+            fprintf(stderr, "    -e  append the time each value is written "
+                            "(for xob -L)\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "Usage: %s [-f] [-e] tracefile\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    trace = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "r");
+    if (trace == NULL)
+    {
+        fprintf(stderr, "Error: could not open trace file %s.\n",
+                argv[optind]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* xob exiting ends the replay */
+    signal(SIGPIPE, SIG_IGN);
+
+    while (fgets(line, sizeof(line), trace) != NULL)
+    {
+        Microseconds time;
+        Microseconds due;
+        Microseconds now;
+        char value[LINE_SIZE];
+        size_t length;
+        bool alternative;
+        char first_character = line[strspn(line, " \t\n")];
+
+        number++;
+        /* Comments and blank lines */
+        if (first_character == '#' || first_character == '\0')
+            continue;
+        if (sscanf(line, "%lld %255s", &time, value) != 2)
+        {
+            fprintf(stderr, "Warning: line %d of the trace is not a time "
+                            "followed by a value.\n",
+                    number);
+            continue;
+        }
+
+        if (first < 0)
+            first = time;
+        due = start + (time - first);
+        if (!fast)
+            sleep_until(due);
+
+        now = monotonic_now();
+        if (!fast && now - due > late)
+            late = now - due;
+        /* The stamp goes before the "!" of the alternative mode */
+        length = strlen(value);
+        alternative = length > 0 && value[length - 1] == '!';
+        if (stamped)
+            printf("%.*s#%lld%s\n", (int)(length - alternative), value, now,
+                   alternative ? "!" : "");
+        else
+            printf("%s\n", value);
+
+        /* Each value reaches xob at its own time */
+        if ((!fast && fflush(stdout) != 0) || ferror(stdout))
+            break;
+        values++;
+    }
+
+    if (fflush(stdout) != 0 && errno != EPIPE)
+        perror("xob-replay");
+    if (trace != stdin)
+        fclose(trace);
+
+    fprintf(stderr,
+            "Info: %ld value(s) replayed in %.1f ms, at most %.1f ms late.\n",
+            values, (monotonic_now() - start) / 1000.0, late / 1000.0);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "shared.h"
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+/* Reads of a record overlapping writes before giving up */
+#define READ_ATTEMPTS 1000
+
+/* Sleep as long as a word has a given value (or until woken up), private
+ * words being only shared with the threads of xob */
+static void futex_wait(uint32_t *word, uint32_t value, bool private)
+{
+    syscall(SYS_futex, word, private ? FUTEX_WAIT_PRIVATE : FUTEX_WAIT,
+            value, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word, bool private)
+{
+    syscall(SYS_futex, word, private ? FUTEX_WAKE_PRIVATE : FUTEX_WAKE, 1,
+            NULL, NULL, 0);
+}
+
+static void *waker_thread(void *argument)
+{
+    Shared_input *input = argument;
+    Xob_record *record = input->record;
+    uint32_t *pending = &input->pending;
+    uint32_t seen = input->taken;
+    uint32_t sequence;
+
+    while (__atomic_load_n(&input->stopped, __ATOMIC_ACQUIRE) ==
+           WAKER_RUNNING)
+    {
+        /* The main loop has not taken the last record yet */
+        if (__atomic_load_n(pending, __ATOMIC_ACQUIRE))
+        {
+            futex_wait(pending, 1, true);
+            continue;
+        }
+
+        /* Ordered with the producer making the sequence even before it
+         * reads waiting: either a new value is seen here or the producer
+         * wakes this thread up */
+        __atomic_store_n(&record->waiting, 1, __ATOMIC_SEQ_CST);
+        sequence = __atomic_load_n(&record->sequence, __ATOMIC_SEQ_CST);
+        if (sequence == seen || sequence & 1)
+        {
+            futex_wait(&record->sequence, sequence, false);
+            continue;
+        }
+        __atomic_store_n(&record->waiting, 0, __ATOMIC_RELAXED);
+
+        seen = sequence;
+        __atomic_store_n(pending, 1, __ATOMIC_RELEASE);
+        eventfd_write(input->fd, 1);
+    }
+
+    __atomic_store_n(&record->waiting, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&input->stopped, WAKER_STOPPED, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool shared_open(Shared_input *input, const char *path)
+{
+    input->record = xob_record_map(path);
+    if (input->record == NULL)
+    {
+        fprintf(stderr, "Error: could not map the record %s.\n", path);
+        return false;
+    }
+
+    /* Values posted before are not shown */
+    input->taken =
+        __atomic_load_n(&input->record->sequence, __ATOMIC_ACQUIRE) & ~1u;
+    input->pending = 0;
+    input->stopped = WAKER_RUNNING;
+    input->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (input->fd < 0 ||
+        pthread_create(&input->thread, NULL, waker_thread, input) != 0)
+    {
+        fprintf(stderr, "Error: could not wait for the record %s.\n", path);
+        if (input->fd >= 0)
+            close(input->fd);
+        xob_record_unmap(input->record);
+        return false;
+    }
+
+    return true;
+}
+
+void shared_take(Shared_input *input, Input_value *newest, int *count,
+                 int *cap)
+{
+    Xob_record *record = input->record;
+    eventfd_t wakeups;
+    uint32_t first;
+    uint32_t last;
+    int record_cap;
+    int attempts = 0;
+
+    /* The next value wakes the main loop up again, even if it is posted
+     * while this one is being read */
+    eventfd_read(input->fd, &wakeups);
+    __atomic_store_n(&input->pending, 0, __ATOMIC_RELEASE);
+    futex_wake(&input->pending, true);
+
+    /* A read overlapping a write is done again, for a while: a producer may
+     * have died in the middle of a write */
+    do
+    {
+        if (attempts > 0)
+            sched_yield();
+        if (attempts++ == READ_ATTEMPTS)
+        {
+            *count = 0;
+            return;
+        }
+        first = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        newest->value = __atomic_load_n(&record->value, __ATOMIC_RELAXED);
+        record_cap = __atomic_load_n(&record->cap, __ATOMIC_RELAXED);
+        newest->show_mode =
+            __atomic_load_n(&record->alternative, __ATOMIC_RELAXED)
+                ? ALTERNATIVE
+                : NORMAL;
+        newest->style = __atomic_load_n(&record->style, __ATOMIC_RELAXED);
+        newest->emitted =
+            __atomic_load_n(&record->emitted, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        last = __atomic_load_n(&record->sequence, __ATOMIC_RELAXED);
+    } while (first != last || first & 1);
+
+    *count = (first - input->taken) / 2;
+    input->taken = first;
+    newest->valid = *count > 0;
+    if (newest->style < 0 || newest->style >= XOB_STYLES_MAX)
+        newest->style = 0;
+    if (*count > 0 && record_cap > 0)
+        *cap = record_cap;
+}
+
+void shared_close(Shared_input *input)
+{
+    struct timespec retry = {.tv_sec = 0, .tv_nsec = 1000000};
+
+    /* The waker may be about to sleep when it is woken up */
+    __atomic_store_n(&input->stopped, WAKER_STOPPING, __ATOMIC_RELEASE);
+    __atomic_store_n(&input->pending, 0, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&input->stopped, __ATOMIC_ACQUIRE) !=
+           WAKER_STOPPED)
+    {
+        futex_wake(&input->pending, true);
+        futex_wake(&input->record->sequence, false);
+        nanosleep(&retry, NULL);
+    }
+    pthread_join(input->thread, NULL);
+    close(input->fd);
+    xob_record_unmap(input->record);
+}
+
+#else
+
+bool shared_open(Shared_input *input, const char *path)
+{
+    (void)input;
+    fprintf(stderr, "Error: no shared record %s on this system.\n", path);
+    return false;
+}
+
+void shared_take(Shared_input *input, Input_value *newest, int *count,
+                 int *cap)
+{
+    (void)input;
+    (void)newest;
+    (void)cap;
+    *count = 0;
+}
+
+void shared_close(Shared_input *input)
+{
+    (void)input;
+}
+
+#endif
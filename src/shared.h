@@ -0,0 +1,64 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARED_H
+#define SHARED_H
+
+#include "input.h"
+#include "xob-producer.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+#define WAKER_RUNNING 0
+#define WAKER_STOPPING 1
+#define WAKER_STOPPED 2
+
+/* Values posted by producers in a record in shared memory (see
+ * xob-producer.h). A waker thread sleeps on the record and makes an eventfd
+ * readable when a value is posted, then waits for the main loop to take it:
+ * it does not wake the main loop again in between, nor is it woken up by
+ * the producers. */
+typedef struct
+{
+    Xob_record *record;
+    int fd;
+    /* Whether the main loop was woken up and has not taken the record yet,
+     * used as a futex */
+    uint32_t pending;
+    /* Set to WAKER_STOPPING by the main loop, then to WAKER_STOPPED by the
+     * waker thread */
+    int stopped;
+    /* Sequence number of the last record taken */
+    uint32_t taken;
+    pthread_t thread;
+} Shared_input;
+
+/* Map the record at a given path and start its waker thread. Returns false
+ * if the record cannot be mapped or the thread cannot be started. */
+bool shared_open(Shared_input *input, const char *path);
+
+/* Take the newest record once the file descriptor is readable. The newest
+ * value replaces *newest, the number of values posted since the last call is
+ * stored in *count and the maximum value of the record, if any, in *cap.
+ * A record still being written after a bounded number of reads gives no
+ * value (*count is 0), the next write wakes the main loop up again. */
+void shared_take(Shared_input *input, Input_value *newest, int *count,
+                 int *cap);
+
+void shared_close(Shared_input *input);
+
+#endif
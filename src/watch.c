@@ -0,0 +1,279 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include "watch.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+
+/* Writes to a file (once per writer, when done), and its replacement by
+ * another one, which changes the link count of the watched one */
+#define WATCH_EVENTS                                                           \
+    (IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* A file appearing in the directory, once the watched one is deleted */
+#define DIRECTORY_EVENTS (IN_CREATE | IN_MOVED_TO)
+#endif
+
+#define NO_FD -1
+
+/* Digits of a number in a file */
+#define NUMBER_SIZE 32
+
+static void watch_file(File_watcher *watcher, Watched_file *file)
+{
+    file->fd = open(file->path, O_RDONLY);
+    file->watch = NO_FD;
+#ifdef __linux__
+    if (watcher->inotify != NO_FD)
+        file->watch =
+            inotify_add_watch(watcher->inotify, file->path, WATCH_EVENTS);
+#else
+    (void)watcher;
+#endif
+}
+
+/* Watch the directory of a file for as long as the watcher is open, so that
+ * the file is watched again if it is deleted and created later */
+static void watch_directory(File_watcher *watcher, Watched_file *file)
+{
+    const char *slash = strrchr(file->path, '/');
+
+    file->name = slash != NULL ? slash + 1 : file->path;
+    file->directory = NO_FD;
+#ifdef __linux__
+    char directory[PATH_MAX];
+
+    if (watcher->inotify == NO_FD)
+        return;
+    if (slash == NULL)
+        strcpy(directory, ".");
+    else if (slash == file->path)
+        strcpy(directory, "/");
+    else if ((size_t)(slash - file->path) < sizeof(directory))
+    {
+        memcpy(directory, file->path, slash - file->path);
+        directory[slash - file->path] = '\0';
+    }
+    else
+        return;
+    file->directory =
+        inotify_add_watch(watcher->inotify, directory, DIRECTORY_EVENTS);
+#else
+    (void)watcher;
+#endif
+}
+
+static void unwatch_file(File_watcher *watcher, Watched_file *file)
+{
+#ifdef __linux__
+    if (file->watch != NO_FD)
+        inotify_rm_watch(watcher->inotify, file->watch);
+#else
+    (void)watcher;
+#endif
+    if (file->fd != NO_FD)
+        close(file->fd);
+    file->fd = NO_FD;
+    file->watch = NO_FD;
+}
+
+/* Whether the path no longer leads to the open file */
+static bool replaced(Watched_file *file)
+{
+    struct stat opened;
+    struct stat current;
+
+    if (file->fd == NO_FD || fstat(file->fd, &opened) == -1 ||
+        stat(file->path, &current) == -1)
+        return true;
+    return opened.st_dev != current.st_dev || opened.st_ino != current.st_ino;
+}
+
+/* Read a number from the beginning of a file. Reading also acknowledges
+ * the change of a sysfs attribute. */
+static bool read_number(Watched_file *file, int *number)
+{
+    char digits[NUMBER_SIZE];
+    char *end;
+    ssize_t length;
+    long value;
+
+    if (file->fd == NO_FD)
+        return false;
+
+    length = pread(file->fd, digits, NUMBER_SIZE - 1, 0);
+    if (length <= 0)
+        return false;
+    digits[length] = '\0';
+
+    value = strtol(digits, &end, 10);
+    if (end == digits)
+        return false;
+
+    *number = value;
+    return true;
+}
+
+bool watcher_open(File_watcher *watcher, const char *value_path,
+                  const char *max_path)
+{
+    int number;
+
+    watcher->inotify = NO_FD;
+#ifdef __linux__
+    watcher->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+    watcher->value.path = value_path;
+    watch_file(watcher, &watcher->value);
+    watch_directory(watcher, &watcher->value);
+    watcher->max.path = max_path;
+    watcher->max.fd = NO_FD;
+    watcher->max.watch = NO_FD;
+    watcher->max.directory = NO_FD;
+    if (max_path != NULL)
+    {
+        watch_file(watcher, &watcher->max);
+        watch_directory(watcher, &watcher->max);
+    }
+
+    if (!read_number(&watcher->value, &number))
+    {
+        fprintf(stderr, "Error: could not read a value from %s.\n",
+                value_path);
+        watcher_close(watcher);
+        return false;
+    }
+    return true;
+}
+
+static int add_fd(int fd, fd_set *fds, int max_fd)
+{
+    if (fd == NO_FD)
+        return max_fd;
+    FD_SET(fd, fds);
+    return fd > max_fd ? fd : max_fd;
+}
+
+int watcher_set_fds(File_watcher *watcher, fd_set *read_fds,
+                    fd_set *except_fds)
+{
+    int max_fd = NO_FD;
+
+    max_fd = add_fd(watcher->inotify, read_fds, max_fd);
+    max_fd = add_fd(watcher->value.fd, except_fds, max_fd);
+    max_fd = add_fd(watcher->max.fd, except_fds, max_fd);
+    return max_fd;
+}
+
+bool watcher_changed(File_watcher *watcher, fd_set *read_fds,
+                     fd_set *except_fds)
+{
+    bool changed = false;
+
+#ifdef __linux__
+    /* Events are aligned on the size of their header */
+    char events[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+
+    if (watcher->inotify != NO_FD && FD_ISSET(watcher->inotify, read_fds))
+    {
+        while ((length = read(watcher->inotify, events, sizeof(events))) > 0)
+        {
+            for (char *e = events; e < events + length;
+                 e += sizeof(struct inotify_event) +
+                      ((struct inotify_event *)e)->len)
+            {
+                struct inotify_event *event = (struct inotify_event *)e;
+                Watched_file *files[] = {&watcher->value, &watcher->max};
+
+                /* Events of removed watches are left */
+                for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+                {
+                    Watched_file *file = files[i];
+
+                    if (event->wd == file->watch)
+                    {
+                        /* Watch the file replacing the watched one */
+                        if (event->mask &
+                                (IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) &&
+                            replaced(file))
+                        {
+                            unwatch_file(watcher, file);
+                            watch_file(watcher, file);
+                        }
+                        changed = true;
+                    }
+                    /* Watch the file created again after being deleted */
+                    else if (event->wd == file->directory && event->len > 0 &&
+                             strcmp(event->name, file->name) == 0 &&
+                             replaced(file))
+                    {
+                        unwatch_file(watcher, file);
+                        watch_file(watcher, file);
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+#else
+    (void)read_fds;
+#endif
+
+    if ((watcher->value.fd != NO_FD &&
+         FD_ISSET(watcher->value.fd, except_fds)) ||
+        (watcher->max.fd != NO_FD && FD_ISSET(watcher->max.fd, except_fds)))
+        changed = true;
+
+    return changed;
+}
+
+bool watcher_read(File_watcher *watcher, int *value, int *max)
+{
+    int number;
+
+    if (read_number(&watcher->max, &number) && number > 0)
+        *max = number;
+    return read_number(&watcher->value, value);
+}
+
+void watcher_close(File_watcher *watcher)
+{
+    unwatch_file(watcher, &watcher->value);
+    unwatch_file(watcher, &watcher->max);
+#ifdef __linux__
+    /* Both files may be in the same directory, under the same watch */
+    if (watcher->value.directory != NO_FD)
+        inotify_rm_watch(watcher->inotify, watcher->value.directory);
+    if (watcher->max.directory != NO_FD &&
+        watcher->max.directory != watcher->value.directory)
+        inotify_rm_watch(watcher->inotify, watcher->max.directory);
+#endif
+    if (watcher->inotify != NO_FD)
+        close(watcher->inotify);
+}
@@ -0,0 +1,68 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdbool.h>
+#include <sys/select.h>
+
+/* A file whose content is a number, kept open. Sysfs attributes signal
+ * changes with an exceptional condition on their descriptor (POLLPRI),
+ * other files with inotify. */
+typedef struct
+{
+    const char *path;
+    int fd;
+    int watch;
+    /* The directory of the file is watched for it to appear again under its
+     * name, which ends its path */
+    const char *name;
+    int directory;
+} Watched_file;
+
+/* The value to display and optionally the maximum value, read directly from
+ * files (e.g. /sys/class/backlight/.../brightness and max_brightness) */
+typedef struct
+{
+    int inotify;
+    Watched_file value;
+    Watched_file max;
+} File_watcher;
+
+/* Start watching a value file and a max file unless its path is NULL.
+ * Returns false if the value file cannot be read. */
+bool watcher_open(File_watcher *watcher, const char *value_path,
+                  const char *max_path);
+
+/* Add the descriptors to wait for to the sets of select(), returns the
+ * highest one */
+int watcher_set_fds(File_watcher *watcher, fd_set *read_fds,
+                    fd_set *except_fds);
+
+/* Whether a file changed according to the sets returned by select() */
+bool watcher_changed(File_watcher *watcher, fd_set *read_fds,
+                     fd_set *except_fds);
+
+/* Read the current value, and the maximum value if there is a max file
+ * (otherwise *max is left as is). Returns false if the value cannot be
+ * read. */
+bool watcher_read(File_watcher *watcher, int *value, int *max);
+
+void watcher_close(File_watcher *watcher);
+
+#endif
@@ -0,0 +1,76 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* libxob-producer: post values to xob -S through a record in shared memory,
+ * without writing to a pipe or formatting text. A value is stored in place
+ * and xob is only woken up if it is waiting for one. Linux only. */
+
+#ifndef XOB_PRODUCER_H
+#define XOB_PRODUCER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* "xob1" */
+#define XOB_RECORD_MAGIC 0x786f6231u
+
+/* The record in the file mapped by the producers and by xob (e.g. under
+ * /dev/shm). A producer makes sequence odd, writes the other fields and
+ * makes it even again, so that a reader overlapping a write reads again
+ * (seqlock). While waiting is not 0, xob sleeps on sequence as a futex and
+ * the producer wakes it up. A producer dying in the middle of a write leaves
+ * sequence odd: the record is wedged, every later value is dropped, until
+ * the file is removed and xob started again. */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t waiting;
+    int32_t value;
+    /* 0 keeps the maximum value xob was started with */
+    int32_t cap;
+    int32_t alternative;
+    /* Position of the style among the styles given to xob, 0 by default */
+    int32_t style;
+    int32_t reserved;
+    /* Time the value was posted in microseconds on CLOCK_MONOTONIC */
+    int64_t emitted;
+} Xob_record;
+
+/* Map the record at a given path for reading and writing, created if
+ * needed. Returns NULL if it cannot be mapped or if the file is not a
+ * record. */
+Xob_record *xob_record_map(const char *path);
+
+void xob_record_unmap(Xob_record *record);
+
+typedef struct Xob_producer Xob_producer;
+
+/* Open the record at a given path as above, NULL on failure */
+Xob_producer *xob_producer_open(const char *path);
+
+/* Post a value between 0 and cap (0 for the maximum value of xob) with a
+ * style given by its position. Several producers may post to the same
+ * record: a value posted while another producer is writing waits for it a
+ * bounded time (about a thousand yields) and is dropped if the record is
+ * still being written. Returns false if the value was dropped. */
+bool xob_producer_post(Xob_producer *producer, int value, int cap,
+                       bool alternative, int style);
+
+void xob_producer_close(Xob_producer *producer);
+
+#endif
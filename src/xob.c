@@ -0,0 +1,536 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include "xob.h"
+#include "conf.h"
+#include "display.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Microseconds on a clock that cannot jump */
+typedef long long Microseconds;
+
+#define NO_DEADLINE -1
+
+/* The first value was already drawn */
+#define NOT_FIRST -2
+
+/* Backend of the bars opened next, NULL for the best one */
+static const Renderer *renderer = NULL;
+
+struct Xob
+{
+    /* Preloaded styles, each with its own colors, geometry and resources on
+     * the X server */
+    Style styles[XOB_STYLES_MAX];
+    Display_context display_contexts[XOB_STYLES_MAX];
+    int styles_count;
+    /* The selected style */
+    Style *style;
+    Display_context *display_context;
+    int timeout;
+    Xob_listener listener;
+    void *listener_data;
+    bool displayed;
+    /* Frame rate governor: values shown before the next frame slot only
+     * replace the pending value */
+    Microseconds frame_interval;
+    Microseconds next_frame;
+    Microseconds hide_deadline;
+    /* A hidden bar releases its window at this deadline */
+    Microseconds release_deadline;
+    /* Time the first value was shown, until it is drawn */
+    Microseconds first_show;
+    bool pending;
+    int pending_value;
+    int pending_cap;
+    bool pending_alternative;
+    /* Time the pending value was shown */
+    Microseconds pending_shown;
+    /* Time the caller woke up for the next value and for the pending one,
+     * -1 if unknown */
+    Microseconds woken;
+    Microseconds pending_woken;
+    int dropped;
+    /* Latencies, the X server confirms one update out of trace_sample */
+    int trace_sample;
+    long long updates;
+    Xob_stats stats;
+};
+
+static Microseconds monotonic_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (Microseconds)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* The earliest of two deadlines */
+static Microseconds earliest(Microseconds a, Microseconds b)
+{
+    if (a == NO_DEADLINE)
+        return b;
+    else if (b == NO_DEADLINE)
+        return a;
+    else
+        return a < b ? a : b;
+}
+
+static void record_latency(Xob_latency *latency, Microseconds duration)
+{
+    int bucket = 0;
+
+    duration = duration > 0 ? duration : 0;
+    while (bucket < XOB_LATENCY_BUCKETS - 1 &&
+           duration + 1 >= 2LL << bucket)
+        bucket++;
+
+    latency->count++;
+    latency->total += duration;
+    latency->max = duration > latency->max ? duration : latency->max;
+    latency->buckets[bucket]++;
+}
+
+long long xob_latency_percentile(const Xob_latency *latency, int percent)
+{
+    long long rank = (latency->count * percent + 99) / 100;
+    long long seen = 0;
+
+    for (int i = 0; i < XOB_LATENCY_BUCKETS; i++)
+    {
+        seen += latency->buckets[i];
+        if (seen >= rank && seen > 0)
+        {
+            long long bound = (2LL << i) - 2;
+            return bound < latency->max ? bound : latency->max;
+        }
+    }
+    return latency->max;
+}
+
+static void notify(Xob *xob, Xob_event event)
+{
+    if (xob->listener != NULL)
+        xob->listener(&event, xob->listener_data);
+}
+
+/* Open the configuration file at the given path or the first standard one
+ * that exists, whose real path is stored in real_path */
+static FILE *open_config_file(const char *path, char real_path[PATH_MAX])
+{
+    FILE *config_file = NULL;
+    char xdg_config_file_path[PATH_MAX];
+
+    real_path[0] = '\0';
+
+    /* Case #1: config file in argument */
+    if (path != NULL)
+    {
+        if (realpath(path, real_path) != NULL)
+        {
+            config_file = fopen(real_path, "r");
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Error: could not open specified configuration file.\n");
+            fprintf(stderr,
+                    "Info: falling back to standard configuration files.\n");
+        }
+    }
+
+    /* Case #2: the XDG_CONFIG_HOME environment variable is set */
+    if (config_file == NULL && getenv("XDG_CONFIG_HOME") != NULL)
+    {
+        if (snprintf(xdg_config_file_path, PATH_MAX, "%s/%s/%s",
+                     getenv("XDG_CONFIG_HOME"), DEFAULT_CONFIG_APPNAME,
+                     DEFAULT_CONFIG_FILENAME) < PATH_MAX)
+        {
+            if (realpath(xdg_config_file_path, real_path) != NULL)
+            {
+                config_file = fopen(real_path, "r");
+            }
+        }
+    }
+
+    /* Case #3: falling back to default configuration directory */
+    if (config_file == NULL)
+    {
+        if (snprintf(xdg_config_file_path, PATH_MAX, "%s/.config/%s/%s",
+                     getenv("HOME"), DEFAULT_CONFIG_APPNAME,
+                     DEFAULT_CONFIG_FILENAME) < PATH_MAX)
+        {
+            if (realpath(xdg_config_file_path, real_path) != NULL)
+            {
+                config_file = fopen(real_path, "r");
+            }
+        }
+    }
+
+    /* Case #4: system wide configuration */
+    if (config_file == NULL)
+    {
+        if (realpath(SYSCONFDIR "/" DEFAULT_CONFIG_APPNAME
+                                "/" DEFAULT_CONFIG_FILENAME,
+                     real_path) != NULL)
+        {
+            config_file = fopen(real_path, "r");
+        }
+    }
+
+    return config_file;
+}
+
+Xob *xob_open(const char *config_path, const char *style_name)
+{
+    return xob_open_styles(config_path, &style_name, 1);
+}
+
+Xob *xob_open_styles(const char *config_path, const char *style_names[],
+                     int count)
+{
+    return xob_open_display(NULL, config_path, style_names, count);
+}
+
+bool xob_init_threads(void)
+{
+    return XInitThreads() != 0;
+}
+
+bool xob_set_backend(const char *name)
+{
+    const Renderer *found = name != NULL ? find_renderer(name) : NULL;
+
+    if (name != NULL && found == NULL)
+        return false;
+    renderer = found;
+    return true;
+}
+
+Xob *xob_open_display(const char *display_name, const char *config_path,
+                      const char *style_names[], int count)
+{
+    char real_config_file_path[PATH_MAX];
+    FILE *config_file;
+    Xob *xob;
+    Microseconds start = monotonic_now();
+    size_t server_size = 0;
+
+    if (count < 1 || count > XOB_STYLES_MAX)
+        return NULL;
+    xob = malloc(sizeof(Xob));
+    if (xob == NULL)
+        return NULL;
+
+    /* Styles, from a configuration file parsed once */
+    xob->styles_count = count;
+    for (int i = 0; i < count; i++)
+        xob->styles[i] = DEFAULT_CONFIGURATION;
+    config_file = open_config_file(config_path, real_config_file_path);
+    if (config_file != NULL)
+    {
+        fprintf(stderr, "Info: reading configuration from %s.\n",
+                real_config_file_path);
+        parse_style_configs(config_file, style_names, count,
+                            DEFAULT_CONFIGURATION, xob->styles);
+        fclose(config_file);
+    }
+    else
+        fprintf(stderr, "Info: no configuration file found, using the "
+                        "default style.\n");
+
+    /* Display, shared by the contexts of all the styles */
+    xob->display_contexts[0] = init(xob->styles[0], display_name, renderer);
+    if (xob->display_contexts[0].x.renderer == NULL)
+    {
+        free(xob);
+        return NULL;
+    }
+    for (int i = 1; i < count; i++)
+        xob->display_contexts[i] =
+            init_sibling(xob->styles[i], xob->display_contexts[i - 1]);
+    for (int i = 0; i < count; i++)
+        server_size += xob->display_contexts[i].x.server_size;
+
+    xob->style = &xob->styles[0];
+    xob->display_context = &xob->display_contexts[0];
+    xob->timeout = 1000;
+    xob->listener = NULL;
+    xob->listener_data = NULL;
+    xob->displayed = false;
+    xob->frame_interval =
+        xob->style->max_fps > 0 ? 1000000 / xob->style->max_fps : 0;
+    xob->next_frame = 0;
+    xob->hide_deadline = NO_DEADLINE;
+    xob->release_deadline = NO_DEADLINE;
+    xob->first_show = NO_DEADLINE;
+    xob->pending = false;
+    xob->woken = -1;
+    xob->dropped = 0;
+    xob->trace_sample = 0;
+    xob->updates = 0;
+    xob->stats = (Xob_stats){.producer = {.count = 0}};
+
+    if (xob->display_context->releasable)
+        fprintf(stderr,
+                "Info: ready in %.1f ms, the window is created for the "
+                "first value and released after %d ms hidden.\n",
+                (monotonic_now() - start) / 1000.0, xob->style->release);
+    else
+        fprintf(stderr,
+                "Info: ready in %.1f ms, %d style(s) take about %zu bytes "
+                "on the X server.\n",
+                (monotonic_now() - start) / 1000.0, count, server_size);
+
+    return xob;
+}
+
+bool xob_select_style(Xob *xob, int style)
+{
+    Display_context *previous = xob->display_context;
+    Display_context *next;
+
+    if (style < 0 || style >= xob->styles_count)
+        return false;
+    next = &xob->display_contexts[style];
+    if (next == previous)
+        return true;
+
+    /* The window of the previous style either keeps being displayed with
+     * the next one or is hidden */
+    if (next->x.window != None && next->x.window == previous->x.window)
+    {
+        next->x.mapped = previous->x.mapped;
+        previous->x.mapped = False;
+    }
+    else if (previous->x.mapped)
+        *previous = hide(*previous);
+    previous->display_list.presented = False;
+    next->display_list.presented = False;
+    if (previous->releasable)
+        *previous = release_window(*previous);
+    xob->release_deadline = NO_DEADLINE;
+
+    xob->style = &xob->styles[style];
+    xob->display_context = next;
+    xob->frame_interval =
+        xob->style->max_fps > 0 ? 1000000 / xob->style->max_fps : 0;
+
+    /* A bar in a window of its own is displayed again by the next value */
+    xob->displayed = next->x.mapped;
+    if (!xob->displayed)
+        xob->hide_deadline = NO_DEADLINE;
+    return true;
+}
+
+void xob_set_timeout(Xob *xob, int timeout)
+{
+    xob->timeout = timeout;
+}
+
+void xob_set_listener(Xob *xob, Xob_listener listener, void *data)
+{
+    xob->listener = listener;
+    xob->listener_data = data;
+}
+
+void xob_show(Xob *xob, int value, int cap, bool alternative)
+{
+    xob_show_at(xob, value, cap, alternative, -1);
+}
+
+void xob_set_trace(Xob *xob, int sample)
+{
+    xob->trace_sample = sample > 0 ? sample : 0;
+}
+
+const Xob_stats *xob_get_stats(Xob *xob)
+{
+    return &xob->stats;
+}
+
+void xob_set_wakeup(Xob *xob, long long woken)
+{
+    xob->woken = woken;
+}
+
+void xob_warm(Xob *xob)
+{
+    Display *display = xob->display_context->x.display;
+
+    for (int i = 0; i < xob->styles_count; i++)
+        xob->display_contexts[i] =
+            warm(xob->display_contexts[i], xob->styles[i].overflow);
+
+    /* Including a round trip */
+    if (display != NULL)
+        XSync(display, False);
+}
+
+void xob_show_at(Xob *xob, int value, int cap, bool alternative,
+                 long long emitted)
+{
+    Microseconds now = monotonic_now();
+
+    if (emitted >= 0)
+        record_latency(&xob->stats.producer, now - emitted);
+
+    if (xob->pending)
+        xob->dropped++;
+    xob->pending = true;
+    xob->pending_value = value;
+    xob->pending_cap = cap;
+    xob->pending_alternative = alternative;
+    xob->pending_shown = now;
+    xob->pending_woken = xob->woken;
+    xob->woken = -1;
+    if (xob->first_show == NO_DEADLINE)
+        xob->first_show = now;
+
+    xob_dispatch(xob);
+}
+
+void xob_hide(Xob *xob)
+{
+    Microseconds now = monotonic_now();
+
+    xob->pending = false;
+    xob->hide_deadline = NO_DEADLINE;
+    if (xob->displayed)
+    {
+        *xob->display_context = hide(*xob->display_context);
+        xob->displayed = false;
+        if (xob->display_context->releasable)
+            xob->release_deadline = now + 1000LL * xob->style->release;
+        notify(xob, (Xob_event){.type = XOB_HIDE, .time = now / 1000});
+    }
+}
+
+int xob_get_fd(Xob *xob)
+{
+    Display *display = xob->display_context->x.display;
+
+    return display != NULL ? ConnectionNumber(display) : -1;
+}
+
+int xob_get_timeout(Xob *xob)
+{
+    Microseconds now = monotonic_now();
+    Microseconds deadline =
+        earliest(earliest(xob->pending ? xob->next_frame : NO_DEADLINE,
+                          xob->hide_deadline),
+                 xob->release_deadline);
+
+    if (deadline == NO_DEADLINE)
+        return -1;
+    else if (deadline <= now)
+        return 0;
+    else
+        /* Rounded up so as not to wake up just before the deadline */
+        return (deadline - now + 999) / 1000;
+}
+
+/* Latencies of the value just drawn */
+static void trace(Xob *xob)
+{
+    Microseconds submitted = monotonic_now();
+
+    record_latency(&xob->stats.submit, submitted - xob->pending_shown);
+    if (xob->pending_woken >= 0)
+        record_latency(&xob->stats.wakeup, submitted - xob->pending_woken);
+    xob->updates++;
+    if (xob->trace_sample > 0 && xob->updates % xob->trace_sample == 0 &&
+        xob->display_context->x.display != NULL)
+    {
+        XSync(xob->display_context->x.display, False);
+        record_latency(&xob->stats.ack, monotonic_now() - submitted);
+    }
+}
+
+void xob_dispatch(Xob *xob)
+{
+    Display *display = xob->display_context->x.display;
+    Microseconds now = monotonic_now();
+    XEvent event;
+
+    /* Only events about the compositing manager are selected */
+    while (display != NULL && XPending(display) > 0)
+    {
+        XNextEvent(display, &event);
+        for (int i = 0; i < xob->styles_count; i++)
+            xob->display_contexts[i] =
+                handle_event(xob->display_contexts[i], &event);
+    }
+    refresh_windows(xob->display_contexts, xob->styles_count);
+
+    /* Display the newest value once its frame slot has come */
+    if (xob->pending && now >= xob->next_frame)
+    {
+        *xob->display_context = show(
+            *xob->display_context, xob->pending_value, xob->pending_cap,
+            xob->style->overflow,
+            xob->pending_alternative ? ALTERNATIVE : NORMAL);
+        trace(xob);
+        if (xob->first_show >= 0)
+        {
+            fprintf(stderr,
+                    "Info: first bar drawn %.1f ms after its value, the "
+                    "window takes about %zu bytes on the X server.\n",
+                    (monotonic_now() - xob->first_show) / 1000.0,
+                    xob->display_context->x.server_size);
+            xob->first_show = NOT_FIRST;
+        }
+        notify(xob, (Xob_event){.type = XOB_UPDATE,
+                                .time = now / 1000,
+                                .value = xob->pending_value,
+                                .cap = xob->pending_cap,
+                                .alternative = xob->pending_alternative,
+                                .dropped = xob->dropped});
+        xob->pending = false;
+        xob->dropped = 0;
+        xob->displayed = true;
+        xob->release_deadline = NO_DEADLINE;
+        xob->next_frame = now + xob->frame_interval;
+        xob->hide_deadline =
+            xob->timeout > 0 ? now + 1000LL * xob->timeout : NO_DEADLINE;
+    }
+
+    /* Time to hide the bar */
+    if (xob->displayed && xob->hide_deadline != NO_DEADLINE &&
+        now >= xob->hide_deadline)
+        xob_hide(xob);
+
+    /* Time to release the window of a bar hidden for long enough */
+    if (!xob->displayed && xob->release_deadline != NO_DEADLINE &&
+        now >= xob->release_deadline)
+    {
+        *xob->display_context = release_window(*xob->display_context);
+        xob->release_deadline = NO_DEADLINE;
+    }
+}
+
+void xob_close(Xob *xob)
+{
+    /* The display belongs to the first context */
+    for (int i = xob->styles_count - 1; i >= 0; i--)
+        display_context_destroy(xob->display_contexts[i]);
+    free(xob);
+}
@@ -0,0 +1,166 @@
+/* xob - A lightweight overlay volume/anything bar for the X Window System.
+ * Copyright (C) 2021 Florent Ch.
+ *
+ * xob is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xob is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xob.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* libxob: display xob bars from any program. The caller either runs its own
+ * loop, polling the file descriptor of a bar with the timeout it gives and
+ * calling xob_dispatch() afterwards, or simply calls xob_dispatch() in due
+ * time. Nothing here depends on the internals of xob. */
+
+#ifndef XOB_H
+#define XOB_H
+
+#include <stdbool.h>
+
+typedef struct Xob Xob;
+
+/* Styles preloaded by a bar at most */
+#define XOB_STYLES_MAX 16
+
+typedef enum
+{
+    /* A value was displayed */
+    XOB_UPDATE,
+    /* The bar was hidden */
+    XOB_HIDE
+} Xob_event_type;
+
+typedef struct
+{
+    Xob_event_type type;
+    /* Milliseconds on a monotonic clock */
+    long long time;
+    /* Displayed value (XOB_UPDATE) */
+    int value;
+    int cap;
+    bool alternative;
+    /* Values shown since the last update but replaced by a newer one before
+     * they could be displayed (XOB_UPDATE) */
+    int dropped;
+} Xob_event;
+
+typedef void (*Xob_listener)(const Xob_event *event, void *data);
+
+/* Latencies of a stage of the updates in microseconds, counted in buckets of
+ * powers of two: bucket i holds latencies from 2^i - 1 to 2^(i+1) - 2 */
+#define XOB_LATENCY_BUCKETS 32
+
+typedef struct
+{
+    long long count;
+    long long total;
+    long long max;
+    long long buckets[XOB_LATENCY_BUCKETS];
+} Xob_latency;
+
+typedef struct
+{
+    /* From a producer emitting a value to xob_show_at() */
+    Xob_latency producer;
+    /* From xob_show_at() to the drawing of the value being sent */
+    Xob_latency submit;
+    /* From the drawing being sent to the X server confirming that it is
+     * done, for sampled updates */
+    Xob_latency ack;
+    /* From the caller waking up for a value to its drawing being sent, if
+     * the caller tells when (xob_set_wakeup()) */
+    Xob_latency wakeup;
+} Xob_stats;
+
+/* Open a bar with a style from a configuration file, or from the standard
+ * configuration files if the path is NULL. Returns NULL if the display
+ * cannot be opened. */
+Xob *xob_open(const char *config_path, const char *style_name);
+
+/* Open a bar with several styles preloaded, the first one being selected.
+ * Returns NULL if the display cannot be opened or if there are no styles or
+ * more than XOB_STYLES_MAX. */
+Xob *xob_open_styles(const char *config_path, const char *style_names[],
+                     int count);
+
+/* Open a bar with several styles on a display given by its name (e.g. ":1"),
+ * or by the DISPLAY environment variable if it is NULL */
+Xob *xob_open_display(const char *display_name, const char *config_path,
+                      const char *style_names[], int count);
+
+/* Allow bars to be used by several threads, each bar by a single thread at
+ * a time. Must be called before any other function. Returns false if it is
+ * not supported. */
+bool xob_init_threads(void);
+
+/* Draw the bars opened next with a backend given by its name: "xrender"
+ * (if built in), "xlib" or "null", which draws nothing and needs no display.
+ * NULL selects the best backend the display supports (default). Returns
+ * false if there is no such backend. */
+bool xob_set_backend(const char *name);
+
+/* Select the style of the next values by its position in the styles of
+ * xob_open_styles(), at no cost: everything is prepared when the bar is
+ * opened. Returns false if there is no such style. */
+bool xob_select_style(Xob *xob, int style);
+
+/* Duration in milliseconds a value remains on screen, 0 for ever (default:
+ * 1000) */
+void xob_set_timeout(Xob *xob, int timeout);
+
+/* Function called for each event of the bar */
+void xob_set_listener(Xob *xob, Xob_listener listener, void *data);
+
+/* Display a value between 0 and cap. Within the frame rate of the style, it
+ * is displayed at once, otherwise by xob_dispatch() at the next frame. */
+void xob_show(Xob *xob, int value, int cap, bool alternative);
+
+/* Display a value emitted by a producer at a given time in microseconds on
+ * CLOCK_MONOTONIC, or -1 if unknown, for the statistics of latencies */
+void xob_show_at(Xob *xob, int value, int cap, bool alternative,
+                 long long emitted);
+
+/* Time the caller woke up for the next value shown, in microseconds on
+ * CLOCK_MONOTONIC, for the statistics of latencies */
+void xob_set_wakeup(Xob *xob, long long woken);
+
+/* Draw every style once without displaying it, so that the first value
+ * shown after a long time hidden does not wait for the render path to be
+ * paged in. Styles whose window is only created when needed are skipped. */
+void xob_warm(Xob *xob);
+
+/* Wait for the X server to confirm the drawing of one update out of sample
+ * (0 for none, the default) in order to measure the whole latency */
+void xob_set_trace(Xob *xob, int sample);
+
+/* Latencies of the updates so far */
+const Xob_stats *xob_get_stats(Xob *xob);
+
+/* Upper bound of the given percentile of latencies */
+long long xob_latency_percentile(const Xob_latency *latency, int percent);
+
+/* Hide the bar at once */
+void xob_hide(Xob *xob);
+
+/* File descriptor to poll for reading along with the timeout below, -1 if
+ * the backend needs no display */
+int xob_get_fd(Xob *xob);
+
+/* Milliseconds before xob_dispatch() must be called, -1 if not needed until
+ * the file descriptor is readable or a value is shown */
+int xob_get_timeout(Xob *xob);
+
+/* Display pending values and hide the bar when it is time */
+void xob_dispatch(Xob *xob);
+
+void xob_close(Xob *xob);
+
+#endif